@@ -29,6 +29,11 @@
 #include "newcpu.h"
 #include "flashrom.h"
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define AKIKO_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #define AKIKO_DEBUG_NVRAM 0
 #define AKIKO_DEBUG_IO 0
 #define AKIKO_DEBUG_IO_CMD 0
@@ -134,17 +139,43 @@ static uae_u32 akiko_buffer[8];
 static int akiko_read_offset, akiko_write_offset;
 static uae_u32 akiko_result[8];
 
-#if 0
-static void akiko_c2p_do (void)
+/* Plain bit loop, reference for the C2P self test */
+static void akiko_c2p_ref (uae_u32 *result)
 {
 	int i;
 
 	for (i = 0; i < 8; i++)
-		akiko_result[i] = 0;
-	/* FIXME: better c2p algoritm than this piece of crap.... */
+		result[i] = 0;
 	for (i = 0; i < 8 * 32; i++) {
 		if (akiko_buffer[7 - (i >> 5)] & (1 << (i & 31)))
-			akiko_result[i & 7] |= 1 << (i >> 3);
+			result[i & 7] |= 1 << (i >> 3);
+	}
+}
+
+#if 0
+static void akiko_c2p_do (void)
+{
+	akiko_c2p_ref (akiko_result);
+}
+#elif AKIKO_SSE2
+/* 8x32 bit matrix transpose. Longs are loaded in reverse order so that
+ * movemask of each byte's top bit gives one plane, bytes are then
+ * shifted left to bring the next plane bit up.
+ */
+static void akiko_precalculate (void)
+{
+}
+
+static void akiko_c2p_do (void)
+{
+	__m128i lo = _mm_shuffle_epi32 (_mm_loadu_si128 ((__m128i*)(akiko_buffer + 4)), _MM_SHUFFLE (0, 1, 2, 3));
+	__m128i hi = _mm_shuffle_epi32 (_mm_loadu_si128 ((__m128i*)(akiko_buffer + 0)), _MM_SHUFFLE (0, 1, 2, 3));
+	int i;
+
+	for (i = 7; i >= 0; i--) {
+		akiko_result[i] = _mm_movemask_epi8 (lo) | (_mm_movemask_epi8 (hi) << 16);
+		lo = _mm_add_epi8 (lo, lo);
+		hi = _mm_add_epi8 (hi, hi);
 	}
 }
 #else
@@ -230,6 +261,139 @@ static uae_u32 akiko_c2p_read (int offset)
 	return v >> (8 * (3 - offset));
 }
 
+/* C2P burst long access, same as four byte accesses from 0x3b to 0x38 */
+static void akiko_c2p_lwrite (uae_u32 v)
+{
+	akiko_buffer[akiko_write_offset] = v;
+	akiko_write_offset = (akiko_write_offset + 1) & 7;
+	akiko_read_offset = 0;
+}
+
+static uae_u32 akiko_c2p_lread (void)
+{
+	uae_u32 v;
+
+	if (akiko_read_offset == 0)
+		akiko_c2p_do ();
+	akiko_write_offset = 0;
+	v = akiko_result[akiko_read_offset];
+	akiko_read_offset = (akiko_read_offset + 1) & 7;
+	return v;
+}
+
+/* Compares the C2P transpose against the bit loop, and long accesses
+ * against byte accesses, on random bursts.
+ */
+#define C2PTEST_MAXERRORS 10
+
+struct c2ptest_state
+{
+	uae_u32 buffer[8], result[8];
+	int read_offset, write_offset;
+};
+
+static void c2ptest_get (struct c2ptest_state *s)
+{
+	memcpy (s->buffer, akiko_buffer, sizeof s->buffer);
+	memcpy (s->result, akiko_result, sizeof s->result);
+	s->read_offset = akiko_read_offset;
+	s->write_offset = akiko_write_offset;
+}
+
+static void c2ptest_set (const struct c2ptest_state *s)
+{
+	memcpy (akiko_buffer, s->buffer, sizeof s->buffer);
+	memcpy (akiko_result, s->result, sizeof s->result);
+	akiko_read_offset = s->read_offset;
+	akiko_write_offset = s->write_offset;
+}
+
+static uae_u32 c2ptest_random (void)
+{
+	switch (uaerand () & 7)
+	{
+	case 0: return 0;
+	case 1: return 0xffffffff;
+	case 2: return 1 << (uaerand () & 31);
+	default: return (uaerand () << 16) ^ uaerand ();
+	}
+}
+
+void akiko_c2p_selftest (int loops, uae_u32 seed)
+{
+	struct c2ptest_state live, init, res[2];
+	uae_u32 ref[8], reads[2][16];
+	uae_u32 saverand = uaerandgetseed ();
+	int tested = 0, errors = 0;
+
+	if (loops <= 0)
+		loops = 100000;
+	c2ptest_get (&live);
+	console_out_f (_T("Akiko C2P self test, seed %08X, %d blocks\n"), seed, loops);
+	uaesrand (seed);
+	for (int l = 0; l < loops; l++) {
+		int ops[16], nops = 1 + uaerand () % 16;
+		bool bad = false;
+
+		for (int i = 0; i < 8; i++) {
+			init.buffer[i] = c2ptest_random ();
+			init.result[i] = c2ptest_random ();
+		}
+		init.read_offset = uaerand () & 7;
+		init.write_offset = uaerand () & 7;
+
+		c2ptest_set (&init);
+		akiko_c2p_ref (ref);
+		akiko_c2p_do ();
+		if (memcmp (ref, akiko_result, sizeof ref))
+			bad = true;
+
+		// mostly full bursts, sometimes partial or mixed
+		for (int i = 0; i < nops; i++)
+			ops[i] = (uaerand () & 3) ? (i < 8 ? 1 : 0) : uaerand () & 1;
+		for (int j = 0; j < 2; j++) {
+			c2ptest_set (&init);
+			for (int i = 0; i < nops; i++) {
+				uae_u32 v = init.buffer[i & 7] ^ i;
+				reads[j][i] = 0;
+				if (ops[i] && j) {
+					akiko_c2p_lwrite (v);
+				} else if (ops[i]) {
+					for (int k = 3; k >= 0; k--)
+						akiko_c2p_write (k, (v >> (8 * (3 - k))) & 0xff);
+				} else if (j) {
+					reads[j][i] = akiko_c2p_lread ();
+				} else {
+					for (int k = 3; k >= 0; k--)
+						reads[j][i] |= (akiko_c2p_read (k) & 0xff) << (8 * (3 - k));
+				}
+			}
+			c2ptest_get (&res[j]);
+		}
+		if (memcmp (reads[0], reads[1], nops * sizeof (uae_u32)) || memcmp (&res[0], &res[1], sizeof res[0]))
+			bad = true;
+		tested++;
+
+		if (bad) {
+			errors++;
+			if (errors <= C2PTEST_MAXERRORS) {
+				console_out_f (_T("Mismatch %d: buffer"), errors);
+				for (int i = 0; i < 8; i++)
+					console_out_f (_T(" %08X"), init.buffer[i]);
+				console_out_f (_T("\n ref   "));
+				for (int i = 0; i < 8; i++)
+					console_out_f (_T(" %08X"), ref[i]);
+				console_out_f (_T("\n bursts %d, offsets %d %d / %d %d\n"), nops,
+					res[0].read_offset, res[0].write_offset, res[1].read_offset, res[1].write_offset);
+			}
+		}
+	}
+	c2ptest_set (&live);
+	uaesrand (saverand);
+
+	console_out_f (_T("%d blocks tested, %d mismatches.\n"), tested, errors);
+}
+
 /* CD32 CDROM hardware emulation
 * Akiko addresses used:
 * 0xb80004-0xb80028
@@ -1491,6 +1655,8 @@ static uae_u32 REGPARAM2 akiko_lget (uaecptr addr)
 	special_mem |= S_READ;
 #endif
 	addr &= 0xffff;
+	if (addr == 0x38 && currprefs.cs_cd32c2p)
+		return akiko_c2p_lread ();
 	v = akiko_bget2 (addr + 3, 0);
 	v |= akiko_bget2 (addr + 2, 0) << 8;
 	v |= akiko_bget2 (addr + 1, 0) << 16;
@@ -1639,6 +1805,10 @@ static void REGPARAM2 akiko_lput (uaecptr addr, uae_u32 v)
 	special_mem |= S_WRITE;
 #endif
 	addr &= 0xffff;
+	if (addr == 0x38 && currprefs.cs_cd32c2p) {
+		akiko_c2p_lwrite (v);
+		return;
+	}
 	if(addr < 0x30 && AKIKO_DEBUG_IO)
 		write_log (_T("akiko_lput %08X: %08X=%08X\n"), M68K_GETPC, addr, v);
 	akiko_bput2 (addr + 3, (v >> 0) & 0xff, 0);
@@ -24,6 +24,11 @@
 #include "savestate.h"
 #include "debug.h"
 
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BLITTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
 // 1 = logging
 // 2 = no wait detection
 // 4 = no D
@@ -71,6 +76,19 @@ static uae_u8 blit_filltable[256][4][2];
 uae_u32 blit_masktable[BLITTER_MAX_WORDS];
 enum blitter_states bltstate;
 
+// per minterm usage, last entry is line mode
+#define BLITSTAT_LINE 256
+struct blitstat
+{
+	uae_u32 blits, desc, fill;
+	uae_u32 rows, special, generic;
+	uae_u64 words;
+	uae_u64 time;
+};
+static struct blitstat blitstats[BLITSTAT_LINE + 1];
+static int blitstats_timed;
+static int blit_rows_off, blit_special_off;
+
 static int blit_cyclecounter, blit_waitcyclecounter;
 static int blit_maxcyclecounter, blit_slowdown, blit_totalcyclecounter;
 static int blit_startcycles, blit_misscyclecounter;
@@ -441,6 +459,239 @@ STATIC_INLINE void chipmem_agnus_wput2 (uaecptr addr, uae_u32 w)
 	}
 }
 
+/* Row based blit for immediate and non cycle-exact blits. Whole rows
+ * of A/B/C are loaded, shifted and combined in one pass (SSE2 when
+ * available). Only used when all channels are inside directly
+ * addressable chip RAM and D does not overlap a source other than
+ * in place, so the result is identical to the word loop.
+ */
+
+static uae_u16 blit_rowa[BLITTER_MAX_WORDS + 1], blit_rowb[BLITTER_MAX_WORDS + 1];
+static uae_u16 blit_rowah[BLITTER_MAX_WORDS], blit_rowbh[BLITTER_MAX_WORDS];
+static uae_u16 blit_rowc[BLITTER_MAX_WORDS], blit_rowd[BLITTER_MAX_WORDS];
+
+struct blit_rowch
+{
+	uaecptr pt;
+	int mod;
+	uae_s64 lo, hi;
+};
+
+static bool blit_rows_channel (struct blit_rowch *ch, uaecptr pt, int mod, int desc, uae_u32 size)
+{
+	int w = blt_info.hblitsize * 2;
+	uae_s64 step = desc ? -(w + mod) : w + mod;
+	uae_s64 first = pt;
+	uae_s64 last = first + step * (blt_info.vblitsize - 1);
+
+	ch->pt = pt;
+	ch->mod = mod;
+	if (!pt)
+		return true;
+	if (first > last) {
+		uae_s64 t = first;
+		first = last;
+		last = t;
+	}
+	if (desc) {
+		ch->lo = first - w + 2;
+		ch->hi = last + 2;
+	} else {
+		ch->lo = first;
+		ch->hi = last + w;
+	}
+	return ch->lo >= 0 && ch->hi <= size;
+}
+
+// D may only share memory with a source if both walk the same
+// addresses and rows never come back to an already written address.
+static bool blit_rows_alias (struct blit_rowch *s, struct blit_rowch *d)
+{
+	if (!s->pt || !d->pt)
+		return true;
+	if (s->hi <= d->lo || d->hi <= s->lo)
+		return true;
+	return s->pt == d->pt && s->mod == d->mod && d->mod >= 0;
+}
+
+// src[0] = previous word, src[1..n] = words in fetch order
+static void blit_rows_shift (uae_u16 *dst, const uae_u16 *src, int n, int shift, int desc)
+{
+	int i = 0;
+#if BLITTER_SSE2
+	__m128i rs = _mm_cvtsi32_si128 (shift);
+	__m128i ls = _mm_cvtsi32_si128 (16 - shift);
+	for (; i + 8 <= n; i += 8) {
+		__m128i p = _mm_loadu_si128 ((const __m128i*)(src + i));
+		__m128i c = _mm_loadu_si128 ((const __m128i*)(src + i + 1));
+		__m128i r;
+		if (desc)
+			r = _mm_or_si128 (_mm_srl_epi16 (p, rs), _mm_sll_epi16 (c, ls));
+		else
+			r = _mm_or_si128 (_mm_srl_epi16 (c, rs), _mm_sll_epi16 (p, ls));
+		_mm_storeu_si128 ((__m128i*)(dst + i), r);
+	}
+#endif
+	for (; i < n; i++) {
+		if (desc)
+			dst[i] = (uae_u16)((src[i] >> shift) | (src[i + 1] << (16 - shift)));
+		else
+			dst[i] = (uae_u16)((src[i + 1] >> shift) | (src[i] << (16 - shift)));
+	}
+}
+
+// any minterm as a 3 level select tree: sel(x,p,q) = q ^ (x & (p ^ q))
+static void blit_rows_minterm (uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int n, uae_u8 mt)
+{
+	uae_u16 m[8];
+	int i = 0;
+
+	for (int k = 0; k < 8; k++)
+		m[k] = (mt & (1 << k)) ? 0xffff : 0x0000;
+#if BLITTER_SSE2
+	__m128i m6 = _mm_set1_epi16 ((short)m[6]), x76 = _mm_set1_epi16 ((short)(m[7] ^ m[6]));
+	__m128i m4 = _mm_set1_epi16 ((short)m[4]), x54 = _mm_set1_epi16 ((short)(m[5] ^ m[4]));
+	__m128i m2 = _mm_set1_epi16 ((short)m[2]), x32 = _mm_set1_epi16 ((short)(m[3] ^ m[2]));
+	__m128i m0 = _mm_set1_epi16 ((short)m[0]), x10 = _mm_set1_epi16 ((short)(m[1] ^ m[0]));
+	for (; i + 8 <= n; i += 8) {
+		__m128i va = _mm_loadu_si128 ((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128 ((const __m128i*)(b + i));
+		__m128i vc = _mm_loadu_si128 ((const __m128i*)(c + i));
+		__m128i t76 = _mm_xor_si128 (m6, _mm_and_si128 (vc, x76));
+		__m128i t54 = _mm_xor_si128 (m4, _mm_and_si128 (vc, x54));
+		__m128i t32 = _mm_xor_si128 (m2, _mm_and_si128 (vc, x32));
+		__m128i t10 = _mm_xor_si128 (m0, _mm_and_si128 (vc, x10));
+		__m128i t1 = _mm_xor_si128 (t54, _mm_and_si128 (vb, _mm_xor_si128 (t76, t54)));
+		__m128i t0 = _mm_xor_si128 (t10, _mm_and_si128 (vb, _mm_xor_si128 (t32, t10)));
+		_mm_storeu_si128 ((__m128i*)(d + i), _mm_xor_si128 (t0, _mm_and_si128 (va, _mm_xor_si128 (t1, t0))));
+	}
+#endif
+	for (; i < n; i++) {
+		uae_u16 t76 = m[6] ^ (c[i] & (m[7] ^ m[6]));
+		uae_u16 t54 = m[4] ^ (c[i] & (m[5] ^ m[4]));
+		uae_u16 t32 = m[2] ^ (c[i] & (m[3] ^ m[2]));
+		uae_u16 t10 = m[0] ^ (c[i] & (m[1] ^ m[0]));
+		uae_u16 t1 = t54 ^ (b[i] & (t76 ^ t54));
+		uae_u16 t0 = t10 ^ (b[i] & (t32 ^ t10));
+		d[i] = t0 ^ (a[i] & (t1 ^ t0));
+	}
+}
+
+static bool blitter_dofast_rows (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, int desc)
+{
+	struct blit_rowch cha, chb, chc, chd;
+	int w = blt_info.hblitsize;
+	int dir = desc ? -2 : 2;
+	int ashift = desc ? blt_info.blitdownashift : blt_info.blitashift;
+	int bshift = desc ? blt_info.blitdownbshift : blt_info.blitbshift;
+	int amod = desc ? -blt_info.bltamod : blt_info.bltamod;
+	int bmod = desc ? -blt_info.bltbmod : blt_info.bltbmod;
+	int cmod = desc ? -blt_info.bltcmod : blt_info.bltcmod;
+	int dmod = desc ? -blt_info.bltdmod : blt_info.bltdmod;
+	uae_u8 mt = bltcon0 & 0xff;
+	uae_u16 preva = 0, prevb = 0, lasta = 0, lastb = 0, lastc = 0;
+	uae_u16 zero = 0;
+	uae_u32 size;
+	uae_u8 *mem;
+	int i, j;
+
+	if (w > BLITTER_MAX_WORDS || (log_blitter & 4) || memwatch_enabled)
+		return false;
+	mem = chipmem_dma_base (&size);
+	if (!mem)
+		return false;
+	if (!blit_rows_channel (&cha, pta, blt_info.bltamod, desc, size) ||
+		!blit_rows_channel (&chb, ptb, blt_info.bltbmod, desc, size) ||
+		!blit_rows_channel (&chc, ptc, blt_info.bltcmod, desc, size) ||
+		!blit_rows_channel (&chd, ptd, blt_info.bltdmod, desc, size))
+		return false;
+	if (!blit_rows_alias (&cha, &chd) || !blit_rows_alias (&chb, &chd) || !blit_rows_alias (&chc, &chd))
+		return false;
+
+	if (!ptb) {
+		for (i = 0; i < w; i++)
+			blit_rowbh[i] = blt_info.bltbhold;
+	}
+	if (!ptc) {
+		for (i = 0; i < w; i++)
+			blit_rowc[i] = blt_info.bltcdat;
+	}
+	for (j = 0; j < blt_info.vblitsize; j++) {
+		blit_rowa[0] = preva;
+		if (pta) {
+			for (i = 0; i < w; i++) {
+				lasta = do_get_mem_word ((uae_u16*)(mem + pta));
+				blit_rowa[i + 1] = lasta & blit_masktable[i];
+				pta += dir;
+			}
+			pta += amod;
+		} else {
+			for (i = 0; i < w; i++)
+				blit_rowa[i + 1] = blt_info.bltadat & blit_masktable[i];
+		}
+		preva = blit_rowa[w];
+		blit_rows_shift (blit_rowah, blit_rowa, w, ashift, desc);
+		if (ptb) {
+			blit_rowb[0] = prevb;
+			for (i = 0; i < w; i++) {
+				blit_rowb[i + 1] = do_get_mem_word ((uae_u16*)(mem + ptb));
+				ptb += dir;
+			}
+			ptb += bmod;
+			prevb = lastb = blit_rowb[w];
+			blit_rows_shift (blit_rowbh, blit_rowb, w, bshift, desc);
+		}
+		if (ptc) {
+			for (i = 0; i < w; i++) {
+				blit_rowc[i] = do_get_mem_word ((uae_u16*)(mem + ptc));
+				ptc += dir;
+			}
+			ptc += cmod;
+			lastc = blit_rowc[w - 1];
+		}
+		blit_rows_minterm (blit_rowd, blit_rowah, blit_rowbh, blit_rowc, w, mt);
+		if (blitfill) {
+			int ifemode = blitife ? 2 : 0;
+			blitfc = !!(bltcon1 & 0x4);
+			for (i = 0; i < w; i++) {
+				uae_u16 d = blit_rowd[i];
+				int fc1 = blit_filltable[d & 255][ifemode + blitfc][1];
+				blit_rowd[i] = (blit_filltable[d & 255][ifemode + blitfc][0]
+					+ (blit_filltable[d >> 8][ifemode + fc1][0] << 8));
+				blitfc = blit_filltable[d >> 8][ifemode + fc1][1];
+			}
+		}
+		if (ptd) {
+			for (i = 0; i < w; i++) {
+				zero |= blit_rowd[i];
+				do_put_mem_word ((uae_u16*)(mem + ptd), blit_rowd[i]);
+				ptd += dir;
+			}
+			ptd += dmod;
+		} else {
+			for (i = 0; i < w; i++)
+				zero |= blit_rowd[i];
+		}
+	}
+
+	if (pta)
+		blt_info.bltadat = lasta;
+	if (ptb) {
+		blt_info.bltbdat = lastb;
+		blt_info.bltbhold = blit_rowbh[w - 1];
+	}
+	if (ptc) {
+		blt_info.bltcdat = lastc;
+		// descending mode C fetch also updates BLTBDAT
+		if (desc)
+			blt_info.bltbdat = lastc;
+	}
+	blt_info.bltddat = blit_rowd[w - 1];
+	if (zero)
+		blt_info.blitzero = 0;
+	return true;
+}
+
 static void blitter_dofast (void)
 {
 	int i,j;
@@ -467,12 +718,17 @@ static void blitter_dofast (void)
 		bltdpt += (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
 
+	if (!blit_rows_off && blitter_dofast_rows (bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, 0)) {
+		blitstats[mt].rows++;
+	} else
 #if SPEEDUP
-	if (blitfunc_dofast[mt] && !blitfill) {
+	if (!blit_special_off && blitfunc_dofast[mt] && !blitfill) {
+		blitstats[mt].special++;
 		(*blitfunc_dofast[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
 	} else
 #endif
 	{
+		blitstats[mt].generic++;
 		uae_u32 blitbhold = blt_info.bltbhold;
 		uae_u32 preva = 0, prevb = 0;
 		uaecptr dstp = 0;
@@ -566,12 +822,17 @@ static void blitter_dofast_desc (void)
 		bltddatptr = bltdpt;
 		bltdpt -= (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
+	if (!blit_rows_off && blitter_dofast_rows (bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, 1)) {
+		blitstats[mt].rows++;
+	} else
 #if SPEEDUP
-	if (blitfunc_dofast_desc[mt] && !blitfill) {
+	if (!blit_special_off && blitfunc_dofast_desc[mt] && !blitfill) {
+		blitstats[mt].special++;
 		(*blitfunc_dofast_desc[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
 	} else
 #endif
 	{
+		blitstats[mt].generic++;
 		uae_u32 blitbhold = blt_info.bltbhold;
 		uae_u32 preva = 0, prevb = 0;
 		uaecptr dstp = 0;
@@ -847,6 +1108,10 @@ static void decide_blitter_line (int hsync, int hpos)
 
 static void actually_do_blit (void)
 {
+	frame_time_t t = 0;
+
+	if (blitstats_timed)
+		t = read_processor_time ();
 	if (blitline) {
 		do {
 			blitter_read ();
@@ -871,6 +1136,234 @@ static void actually_do_blit (void)
 			blitter_dofast ();
 		bltstate = BLT_done;
 	}
+	if (blitstats_timed)
+		blitstats[blitline ? BLITSTAT_LINE : (bltcon0 & 0xff)].time += read_processor_time () - t;
+}
+
+// host timing of immediate blits only runs after the first reset
+void blitter_reset_stats (void)
+{
+	memset (blitstats, 0, sizeof blitstats);
+	blitstats_timed = 1;
+}
+
+void blitter_dump_stats (void)
+{
+	int order[BLITSTAT_LINE + 1];
+	int i, j, cnt = 0;
+	uae_u64 total = 0;
+
+	for (i = 0; i <= BLITSTAT_LINE; i++) {
+		if (!blitstats[i].blits)
+			continue;
+		// most expensive first, blit count when nothing was timed
+		for (j = cnt; j > 0; j--) {
+			struct blitstat *a = &blitstats[order[j - 1]], *b = &blitstats[i];
+			if (a->time > b->time || (a->time == b->time && a->blits >= b->blits))
+				break;
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+		cnt++;
+		total += blitstats[i].time;
+	}
+	if (!cnt) {
+		console_out (_T("No blits recorded.\n"));
+		return;
+	}
+	console_out_f (_T("MT      Blits       Words   Desc   Fill   Rows   Spec    Gen      Time    %%\n"));
+	for (i = 0; i < cnt; i++) {
+		struct blitstat *bs = &blitstats[order[i]];
+		TCHAR mt[8];
+		if (order[i] == BLITSTAT_LINE)
+			_tcscpy (mt, _T("line"));
+		else
+			_stprintf (mt, _T("%02X"), order[i]);
+		console_out_f (_T("%-4s %8u %11llu %6u %6u %6u %6u %6u %7.2fms %3d\n"),
+			mt, bs->blits, bs->words, bs->desc, bs->fill, bs->rows, bs->special, bs->generic,
+			syncbase > 0 ? bs->time * 1000.0 / syncbase : 0.0,
+			total ? (int)(bs->time * 100 / total) : 0);
+	}
+	if (!blitstats_timed)
+		console_out (_T("Blit time is not recorded until statistics are reset.\n"));
+}
+
+/* Row path self test: random blits of every minterm are run through
+ * blitter_dofast_rows and through the generic word loop,
+ * memory and final blitter registers must match.
+ */
+#define BLITTEST_BASE 0x10000
+#define BLITTEST_REGION 0x4000
+#define BLITTEST_SIZE (4 * BLITTEST_REGION)
+#define BLITTEST_MAXERRORS 10
+
+struct blittest_result
+{
+	uae_u16 adat, bdat, cdat, ddat, bhold;
+	int zero;
+	uaecptr apt, bpt, cpt, dpt;
+};
+
+static void blittest_run (uae_u8 *mem, uae_u8 *initmem, uae_u8 *resmem, const struct bltinfo *init, const uaecptr *pt, int rowsoff, struct blittest_result *r)
+{
+	memcpy (mem + BLITTEST_BASE, initmem, BLITTEST_SIZE);
+	blt_info = *init;
+	bltapt = pt[0];
+	bltbpt = pt[1];
+	bltcpt = pt[2];
+	bltdpt = pt[3];
+	blitfc = !!(bltcon1 & 0x4);
+	// reference is the plain word loop, not the generated blitfuncs
+	blit_rows_off = blit_special_off = rowsoff;
+	if (blitdesc)
+		blitter_dofast_desc ();
+	else
+		blitter_dofast ();
+	blit_rows_off = blit_special_off = 0;
+	memcpy (resmem, mem + BLITTEST_BASE, BLITTEST_SIZE);
+	memset (r, 0, sizeof *r);
+	r->adat = blt_info.bltadat;
+	r->bdat = blt_info.bltbdat;
+	r->cdat = blt_info.bltcdat;
+	r->ddat = blt_info.bltddat;
+	r->bhold = blt_info.bltbhold;
+	r->zero = blt_info.blitzero;
+	r->apt = bltapt;
+	r->bpt = bltbpt;
+	r->cpt = bltcpt;
+	r->dpt = bltdpt;
+}
+
+void blitter_selftest (int loops, uae_u32 seed)
+{
+	uae_u8 *mem, *savemem, *initmem, *resmem[2];
+	struct bltinfo saveinfo, initinfo;
+	struct blittest_result res[2];
+	struct blitstat savestats[BLITSTAT_LINE + 1];
+	uae_u16 savecon0 = bltcon0, savecon1 = bltcon1;
+	uaecptr savept[4] = { bltapt, bltbpt, bltcpt, bltdpt };
+	int savedesc = blitdesc, savefill = blitfill, saveife = blitife, savefc = blitfc;
+	uae_u32 saverand = uaerandgetseed ();
+	uae_u32 size;
+	int tested = 0, rows = 0, errors = 0;
+
+	if (bltstate != BLT_done) {
+		console_out (_T("Blitter is busy.\n"));
+		return;
+	}
+	if ((log_blitter & 4) || memwatch_enabled) {
+		console_out (_T("Blitter self test needs memwatch points and blitter D logging disabled.\n"));
+		return;
+	}
+	mem = chipmem_dma_base (&size);
+	if (!mem || size < BLITTEST_BASE + BLITTEST_SIZE) {
+		console_out (_T("Blitter self test needs at least 128k of directly mapped chip RAM.\n"));
+		return;
+	}
+	if (loops <= 0)
+		loops = 10;
+	savemem = xmalloc (uae_u8, BLITTEST_SIZE);
+	initmem = xmalloc (uae_u8, BLITTEST_SIZE);
+	resmem[0] = xmalloc (uae_u8, BLITTEST_SIZE);
+	resmem[1] = xmalloc (uae_u8, BLITTEST_SIZE);
+	memcpy (savemem, mem + BLITTEST_BASE, BLITTEST_SIZE);
+	memcpy (savestats, blitstats, sizeof blitstats);
+	saveinfo = blt_info;
+
+	console_out_f (_T("Blitter row path self test, seed %08X, %d blits per minterm\n"), seed, loops);
+	uaesrand (seed);
+	for (int mt = 0; mt < 256; mt++) {
+		for (int l = 0; l < loops; l++) {
+			uaecptr pt[4];
+			int fill = uaerand () % 3;
+			uae_u32 rowsbefore;
+
+			for (int i = 0; i < BLITTEST_SIZE; i += 4)
+				do_put_mem_long ((uae_u32*)(initmem + i), uaerand ());
+			initinfo = saveinfo;
+			initinfo.hblitsize = 1 + uaerand () % 40;
+			initinfo.vblitsize = 1 + uaerand () % 24;
+			initinfo.bltamod = ((int)(uaerand () % 129) - 64) & ~1;
+			initinfo.bltbmod = ((int)(uaerand () % 129) - 64) & ~1;
+			initinfo.bltcmod = ((int)(uaerand () % 129) - 64) & ~1;
+			initinfo.bltdmod = ((int)(uaerand () % 129) - 64) & ~1;
+			initinfo.bltafwm = uaerand ();
+			initinfo.bltalwm = uaerand ();
+			initinfo.bltadat = uaerand ();
+			initinfo.bltbdat = uaerand ();
+			initinfo.bltcdat = uaerand ();
+			initinfo.bltbhold = uaerand ();
+			initinfo.blitzero = 1;
+			bltcon0 = (uae_u16)(((uaerand () & 15) << 12) | ((uaerand () & 15) << 8) | mt);
+			bltcon1 = (uae_u16)(((uaerand () & 15) << 12) | (uaerand () & 4) | (uaerand () & 2));
+			if (fill)
+				bltcon1 |= fill == 1 ? 0x08 : 0x10;
+			// most blits write D
+			if (uaerand () & 3)
+				bltcon0 |= 0x100;
+			initinfo.blitashift = bltcon0 >> 12;
+			initinfo.blitdownashift = 16 - initinfo.blitashift;
+			initinfo.blitbshift = bltcon1 >> 12;
+			initinfo.blitdownbshift = 16 - initinfo.blitbshift;
+			blitdesc = bltcon1 & 2;
+			blitfill = !!(bltcon1 & 0x18);
+			blitife = !!(bltcon1 & 0x8);
+			// channels start in the middle of their own region
+			for (int i = 0; i < 4; i++)
+				pt[i] = BLITTEST_BASE + i * BLITTEST_REGION + BLITTEST_REGION / 2 + (uaerand () & 0x3fe);
+			// sometimes an in place blit, D on top of C
+			if ((uaerand () & 3) == 0) {
+				pt[3] = pt[2];
+				initinfo.bltdmod = initinfo.bltcmod = initinfo.bltcmod < 0 ? -initinfo.bltcmod : initinfo.bltcmod;
+			}
+
+			rowsbefore = blitstats[mt].rows;
+			blittest_run (mem, initmem, resmem[0], &initinfo, pt, 0, &res[0]);
+			if (blitstats[mt].rows != rowsbefore)
+				rows++;
+			blittest_run (mem, initmem, resmem[1], &initinfo, pt, 1, &res[1]);
+			tested++;
+
+			if (memcmp (&res[0], &res[1], sizeof res[0]) || memcmp (resmem[0], resmem[1], BLITTEST_SIZE)) {
+				errors++;
+				if (errors <= BLITTEST_MAXERRORS) {
+					console_out_f (_T("Mismatch %d: BLTCON0=%04X BLTCON1=%04X %dx%d A=%08X B=%08X C=%08X D=%08X\n"),
+						errors, bltcon0, bltcon1, initinfo.hblitsize, initinfo.vblitsize, pt[0], pt[1], pt[2], pt[3]);
+					console_out_f (_T(" DAT A %04X %04X B %04X %04X C %04X %04X D %04X %04X BHOLD %04X %04X ZERO %d %d\n"),
+						res[0].adat, res[1].adat, res[0].bdat, res[1].bdat, res[0].cdat, res[1].cdat,
+						res[0].ddat, res[1].ddat, res[0].bhold, res[1].bhold, res[0].zero, res[1].zero);
+					for (int i = 0; i < BLITTEST_SIZE; i++) {
+						if (resmem[0][i] != resmem[1][i]) {
+							console_out_f (_T(" Memory %08X: %02X %02X\n"), BLITTEST_BASE + i, resmem[0][i], resmem[1][i]);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	memcpy (mem + BLITTEST_BASE, savemem, BLITTEST_SIZE);
+	memcpy (blitstats, savestats, sizeof blitstats);
+	blt_info = saveinfo;
+	bltcon0 = savecon0;
+	bltcon1 = savecon1;
+	bltapt = savept[0];
+	bltbpt = savept[1];
+	bltcpt = savept[2];
+	bltdpt = savept[3];
+	blitdesc = savedesc;
+	blitfill = savefill;
+	blitife = saveife;
+	blitfc = savefc;
+	bltstate = BLT_done;
+	uaesrand (saverand);
+
+	console_out_f (_T("%d blits tested, %d through row path, %d mismatches.\n"), tested, rows, errors);
+	xfree (resmem[0]);
+	xfree (resmem[1]);
+	xfree (initmem);
+	xfree (savemem);
 }
 
 static void blitter_doit (void)
@@ -1544,6 +2037,16 @@ static void do_blitter2 (int hpos, int copper)
 	bltstate = BLT_init;
 	blit_slowdown = 0;
 
+	if (cleanstart) {
+		struct blitstat *bs = &blitstats[blitline ? BLITSTAT_LINE : (bltcon0 & 0xff)];
+		bs->blits++;
+		bs->words += blitline ? blt_info.vblitsize : blt_info.hblitsize * blt_info.vblitsize;
+		if (blitdesc)
+			bs->desc++;
+		if (blitfill)
+			bs->fill++;
+	}
+
 	unset_special (SPCFLAG_BLTNASTY);
 	if (dmaen (DMA_BLITPRI))
 		set_special (SPCFLAG_BLTNASTY);
@@ -50,6 +50,7 @@ struct blkdevstate
 	bool mediawaschanged;
 	struct scsi_data_tape *tape;
 	bool showstatusline;
+	struct blkcache *cache;
 };
 
 struct blkdevstate state[MAX_TOTAL_SCSI_DEVICES];
@@ -285,9 +286,12 @@ static void freesem (int unitnum)
 		write_log (_T("CD: unitsem%d release mismatch! cnt=%d\n"), unitnum, st->sema_cnt);
 	uae_sem_post (&st->sema);
 }
+static void blkdev_cache_free (int unitnum);
+
 static void sys_command_close_internal (int unitnum)
 {
 	struct blkdevstate *st = &state[unitnum];
+	blkdev_cache_flush (unitnum);
 	getsem (unitnum, true);
 	st->waspaused = 0;
 	if (st->isopen <= 0)
@@ -301,6 +305,7 @@ static void sys_command_close_internal (int unitnum)
 	if (st->isopen == 0) {
 		uae_sem_destroy (&st->sema);
 		st->sema = NULL;
+		blkdev_cache_free (unitnum);
 	}
 }
 
@@ -504,6 +509,7 @@ void sys_command_close (int unitnum)
 void blkdev_cd_change (int unitnum, const TCHAR *name)
 {
 	struct device_info di;
+	blkdev_cache_flush (unitnum);
 	sys_command_info (unitnum, &di, 1);
 #ifdef RETROPLATFORM
 	rp_cd_image_change (unitnum, name);
@@ -633,6 +639,7 @@ static void check_changes (int unitnum)
 				}
 			}
 		}
+		blkdev_cache_flush (unitnum);
 		write_log (_T("CD: eject (%s) open=%d\n"), pollmode ? _T("slow") : _T("fast"), st->wasopen ? 1 : 0);
 		if (wasimage)
 			statusline_add_message(_T("CD%d: -"), unitnum);
@@ -656,6 +663,7 @@ static void check_changes (int unitnum)
 	_tcscpy (changed_prefs.cdslots[unitnum].name, st->newimagefile);
 	currprefs.cdslots[unitnum].inuse = changed_prefs.cdslots[unitnum].inuse = st->cdimagefileinuse;
 	st->newimagefile[0] = 0;
+	blkdev_cache_flush (unitnum);
 	write_log (_T("CD: delayed insert '%s' (open=%d,unit=%d)\n"), currprefs.cdslots[unitnum].name[0] ? currprefs.cdslots[unitnum].name : _T("<EMPTY>"), st->wasopen ? 1 : 0, unitnum);
 	device_func_init (0);
 	if (st->wasopen) {
@@ -871,8 +879,7 @@ int sys_command_cd_toc (int unitnum, struct cd_toc_head *toc)
 	return v;
 }
 
-/* read one cd sector */
-int sys_command_cd_read (int unitnum, uae_u8 *data, int block, int size)
+static int cd_read (int unitnum, uae_u8 *data, int block, int size)
 {
 	int v;
 	if (failunit (unitnum))
@@ -894,6 +901,252 @@ int sys_command_cd_read (int unitnum, uae_u8 *data, int block, int size)
 	freesem (unitnum);
 	return v;
 }
+
+/* shared 2048 byte data block cache, hashed and kept in LRU order.
+ * Blocks returned by blkdev_cache_read() stay pinned until released,
+ * pinned blocks are never evicted. Flushed pinned blocks are orphaned
+ * (block = -1) and freed on last release.
+ */
+
+#define BLKCACHE_HASH 1024
+
+struct blkcache_block
+{
+	struct blkcache_block *hnext;
+	struct blkcache_block *prev, *next;
+	int block;
+	int refcnt;
+	uae_u8 data[2048];
+};
+
+struct blkcache
+{
+	uae_sem_t sem;
+	struct blkcache_block *hash[BLKCACHE_HASH];
+	struct blkcache_block *first, *last;
+	int count;
+	int orphans;
+	bool closed;
+	int hits, misses, evictions;
+};
+
+static struct blkcache *blkcache_get (int unitnum)
+{
+	struct blkdevstate *st = &state[unitnum];
+	if (!st->cache) {
+		st->cache = xcalloc (struct blkcache, 1);
+		uae_sem_init (&st->cache->sem, 0, 1);
+	}
+	st->cache->closed = false;
+	return st->cache;
+}
+
+static struct blkcache_block *blkcache_find (struct blkcache *c, int block)
+{
+	struct blkcache_block *b;
+	for (b = c->hash[block & (BLKCACHE_HASH - 1)]; b; b = b->hnext) {
+		if (b->block == block)
+			return b;
+	}
+	return NULL;
+}
+
+static void blkcache_unlink (struct blkcache *c, struct blkcache_block *b)
+{
+	struct blkcache_block **bp;
+	for (bp = &c->hash[b->block & (BLKCACHE_HASH - 1)]; *bp; bp = &(*bp)->hnext) {
+		if (*bp == b) {
+			*bp = b->hnext;
+			break;
+		}
+	}
+	if (b->prev)
+		b->prev->next = b->next;
+	else
+		c->first = b->next;
+	if (b->next)
+		b->next->prev = b->prev;
+	else
+		c->last = b->prev;
+	b->hnext = b->prev = b->next = NULL;
+	c->count--;
+}
+
+static void blkcache_insert (struct blkcache *c, struct blkcache_block *b)
+{
+	struct blkcache_block **bp = &c->hash[b->block & (BLKCACHE_HASH - 1)];
+	b->hnext = *bp;
+	*bp = b;
+	b->prev = NULL;
+	b->next = c->first;
+	if (c->first)
+		c->first->prev = b;
+	else
+		c->last = b;
+	c->first = b;
+	c->count++;
+}
+
+static void blkcache_touch (struct blkcache *c, struct blkcache_block *b)
+{
+	if (c->first == b)
+		return;
+	b->prev->next = b->next;
+	if (b->next)
+		b->next->prev = b->prev;
+	else
+		c->last = b->prev;
+	b->prev = NULL;
+	b->next = c->first;
+	c->first->prev = b;
+	c->first = b;
+}
+
+static void blkcache_trim (struct blkcache *c, int max)
+{
+	struct blkcache_block *b = c->last;
+	while (b && c->count > max) {
+		struct blkcache_block *prev = b->prev;
+		if (!b->refcnt) {
+			blkcache_unlink (c, b);
+			xfree (b);
+			c->evictions++;
+		}
+		b = prev;
+	}
+}
+
+void blkdev_cache_flush (int unitnum)
+{
+	struct blkdevstate *st = &state[unitnum];
+	struct blkcache *c = st->cache;
+	if (!c)
+		return;
+	uae_sem_wait (&c->sem);
+	if (c->hits || c->misses)
+		write_log (_T("CD%d: block cache flush, %d hits, %d misses, %d evictions\n"), unitnum, c->hits, c->misses, c->evictions);
+	while (c->first) {
+		struct blkcache_block *b = c->first;
+		blkcache_unlink (c, b);
+		if (b->refcnt) {
+			b->block = -1;
+			c->orphans++;
+		} else {
+			xfree (b);
+		}
+	}
+	c->hits = c->misses = c->evictions = 0;
+	uae_sem_post (&c->sem);
+}
+
+static void blkcache_destroy (int unitnum)
+{
+	struct blkcache *c = state[unitnum].cache;
+	state[unitnum].cache = NULL;
+	uae_sem_destroy (&c->sem);
+	xfree (c);
+}
+
+/* unit closed: free the cache now, or on the last release of a
+ * block that is still pinned */
+static void blkdev_cache_free (int unitnum)
+{
+	struct blkcache *c = state[unitnum].cache;
+	if (!c)
+		return;
+	blkdev_cache_flush (unitnum);
+	uae_sem_wait (&c->sem);
+	c->closed = true;
+	if (c->orphans) {
+		uae_sem_post (&c->sem);
+		return;
+	}
+	uae_sem_post (&c->sem);
+	blkcache_destroy (unitnum);
+}
+
+/* returns pinned block data, NULL if read failed */
+uae_u8 *blkdev_cache_read (int unitnum, int block)
+{
+	struct blkcache *c;
+	struct blkcache_block *b, *b2;
+
+	if (failunit (unitnum) || block < 0)
+		return NULL;
+	c = blkcache_get (unitnum);
+	uae_sem_wait (&c->sem);
+	b = blkcache_find (c, block);
+	if (b) {
+		c->hits++;
+		b->refcnt++;
+		blkcache_touch (c, b);
+		uae_sem_post (&c->sem);
+		return b->data;
+	}
+	c->misses++;
+	uae_sem_post (&c->sem);
+
+	b = xcalloc (struct blkcache_block, 1);
+	if (cd_read (unitnum, b->data, block, 1) <= 0) {
+		xfree (b);
+		return NULL;
+	}
+	b->block = block;
+	uae_sem_wait (&c->sem);
+	b2 = blkcache_find (c, block);
+	if (b2) {
+		xfree (b);
+		b = b2;
+		blkcache_touch (c, b);
+	} else {
+		blkcache_insert (c, b);
+	}
+	b->refcnt++;
+	blkcache_trim (c, currprefs.cd_block_cache);
+	uae_sem_post (&c->sem);
+	return b->data;
+}
+
+void blkdev_cache_release (int unitnum, uae_u8 *data)
+{
+	struct blkcache *c = state[unitnum].cache;
+	struct blkcache_block *b;
+	if (!c || !data)
+		return;
+	b = (struct blkcache_block*)(data - offsetof (struct blkcache_block, data));
+	uae_sem_wait (&c->sem);
+	b->refcnt--;
+	if (b->refcnt < 0)
+		write_log (_T("CD%d: block cache release mismatch, block %d\n"), unitnum, b->block);
+	if (b->refcnt <= 0) {
+		if (b->block < 0) {
+			xfree (b);
+			c->orphans--;
+			if (c->closed && !c->orphans) {
+				uae_sem_post (&c->sem);
+				blkcache_destroy (unitnum);
+				return;
+			}
+		} else {
+			blkcache_trim (c, currprefs.cd_block_cache);
+		}
+	}
+	uae_sem_post (&c->sem);
+}
+
+/* read one cd sector */
+int sys_command_cd_read (int unitnum, uae_u8 *data, int block, int size)
+{
+	if (size == 1 && currprefs.cd_block_cache > 0) {
+		uae_u8 *p = blkdev_cache_read (unitnum, block);
+		if (!p)
+			return 0;
+		memcpy (data, p, 2048);
+		blkdev_cache_release (unitnum, p);
+		return 1;
+	}
+	return cd_read (unitnum, data, block, size);
+}
 int sys_command_cd_rawread (int unitnum, uae_u8 *data, int block, int size, int sectorsize)
 {
 	int v;
@@ -963,6 +1216,7 @@ int sys_command_write (int unitnum, uae_u8 *data, int offset, int size)
 		v = state[unitnum].device_func->write (unitnum, data, offset, size);
 	}
 	freesem (unitnum);
+	blkdev_cache_flush (unitnum);
 	return v;
 }
 
@@ -983,6 +1237,8 @@ int sys_command_ismedia (int unitnum, int quick)
 		v = state[unitnum].device_func->ismedia (unitnum, quick);
 	}
 	freesem (unitnum);
+	if (v <= 0)
+		blkdev_cache_flush (unitnum);
 	return v;
 }
 
@@ -28,6 +28,7 @@
 #include "memory.h"
 #include "audio.h"
 #include "uae.h"
+#include "crc32.h"
 #ifdef RETROPLATFORM
 #include "rp.h"
 #endif
@@ -44,8 +45,12 @@
 #define scsi_log write_log
 
 #define CDDA_BUFFERS 12
+#define CD_READAHEAD 32
+#define CDDA_UNPACK_THREADS 3 // thread 0 serves playback, others decode ahead
 
 enum audenc { AUDENC_NONE, AUDENC_PCM, AUDENC_MP3, AUDENC_FLAC, ENC_CHD };
+// FILLING: t->data is published, cache load done or decode in progress
+enum unpackstate { UNPACK_NONE, UNPACK_QUEUED, UNPACK_BUSY, UNPACK_FILLING, UNPACK_DONE };
 
 struct cdtoc
 {
@@ -70,6 +75,7 @@ struct cdtoc
 	audenc enctype;
 	int writeoffset;
 	int subcode;
+	volatile int unpackstate;
 #ifdef WITH_CHD
 	const cdrom_track_info *chdtrack;
 #endif
@@ -96,6 +102,12 @@ struct cdunit {
 	int cdda_delay, cdda_delay_frames;
 	bool thread_active;
 
+	/* data sector read-ahead, one track, sectors in image layout */
+	uae_u8 *rcache;
+	int rcache_size;
+	struct cdtoc *rcache_t;
+	int rcache_sector, rcache_cnt;
+
 	TCHAR imgname[MAX_DPATH];
 	uae_sem_t sub_sem;
 	struct device_info di;
@@ -109,7 +121,9 @@ static struct cdunit cdunits[MAX_TOTAL_SCSI_DEVICES];
 static int bus_open;
 
 static volatile int cdimage_unpack_thread, cdimage_unpack_active;
-static smp_comm_pipe unpack_pipe;
+static volatile bool cdimage_unpack_stop;
+static smp_comm_pipe unpack_pipe[CDDA_UNPACK_THREADS];
+static uae_sem_t unpack_sem;
 static uae_sem_t play_sem;
 
 static struct cdunit *unitisopen (int unitnum)
@@ -183,6 +197,67 @@ static int do_read (struct cdunit *cdu, struct cdtoc *t, uae_u8 *data, int secto
 	return 0;
 }
 
+static void rcache_free (struct cdunit *cdu)
+{
+	xfree (cdu->rcache);
+	cdu->rcache = NULL;
+	cdu->rcache_size = 0;
+	cdu->rcache_t = NULL;
+	cdu->rcache_cnt = 0;
+}
+
+// Returns sector in image layout (t->size bytes). A miss reads the wanted
+// sectors with one contiguous read, or CD_READAHEAD sectors if the miss
+// continues the previous read.
+static uae_u8 *read_cached (struct cdunit *cdu, struct cdtoc *t, int sector, int want)
+{
+	int ssize = t->size + t->skipsize;
+	int n, last;
+
+	if (cdu->rcache_t == t && sector >= cdu->rcache_sector && sector < cdu->rcache_sector + cdu->rcache_cnt)
+		return cdu->rcache + (sector - cdu->rcache_sector) * ssize;
+	n = want;
+	if (cdu->rcache_t == t && sector == cdu->rcache_sector + cdu->rcache_cnt)
+		n = CD_READAHEAD;
+	if (n > CD_READAHEAD)
+		n = CD_READAHEAD;
+	last = (t[1].address - t[1].index1) - (t->address - t->index1);
+	if (n > last - sector)
+		n = last - sector;
+	cdu->rcache_t = NULL;
+	cdu->rcache_cnt = 0;
+	if (n <= 0)
+		return NULL;
+	if (cdu->rcache_size < CD_READAHEAD * ssize) {
+		xfree (cdu->rcache);
+		cdu->rcache_size = CD_READAHEAD * ssize;
+		cdu->rcache = xmalloc (uae_u8, cdu->rcache_size);
+	}
+	if (t->enctype == ENC_CHD) {
+#ifdef WITH_CHD
+		while (cdu->rcache_cnt < n && cdrom_read_data (cdu->chd_cdf, sector + cdu->rcache_cnt + t->offset, cdu->rcache + cdu->rcache_cnt * ssize, CD_TRACK_RAW_DONTCARE, true))
+			cdu->rcache_cnt++;
+#endif
+	} else if (t->handle) {
+		zfile_fseek (t->handle, t->offset + (uae_u64)sector * ssize, SEEK_SET);
+		cdu->rcache_cnt = zfile_fread (cdu->rcache, 1, n * ssize, t->handle) / ssize;
+	}
+	if (!cdu->rcache_cnt)
+		return NULL;
+	cdu->rcache_t = t;
+	cdu->rcache_sector = sector;
+	return cdu->rcache;
+}
+
+static int read_sector (struct cdunit *cdu, struct cdtoc *t, uae_u8 *data, int sector, int offset, int size, int want)
+{
+	uae_u8 *p = read_cached (cdu, t, sector, want);
+	if (!p || offset + size > t->size)
+		return do_read (cdu, t, data, sector, offset, size, false);
+	memcpy (data, p + offset, size);
+	return 1;
+}
+
 // WOHOO, library that supports virtual file access functions. Perfect!
 static void flac_metadata_callback (const FLAC__StreamDecoder *decoder, const FLAC__StreamMetadata *metadata, void *client_data)
 {
@@ -370,63 +445,209 @@ static int setstate (struct cdunit *cdu, int state)
 	return 0;
 }
 
+// persistent decoded audio cache, keyed by compressed file contents
+static bool cdda_cache_name (struct cdtoc *t, TCHAR *out)
+{
+	TCHAR path[MAX_DPATH];
+	uae_u8 *buf;
+	uae_u32 key = 0;
+	uae_s64 pos;
+
+	if (!currprefs.cd_audio_cache)
+		return false;
+	buf = xmalloc (uae_u8, 65536);
+	pos = zfile_ftell (t->handle);
+	zfile_fseek (t->handle, 0, SEEK_SET);
+	for (;;) {
+		int len = zfile_fread (buf, 1, 65536, t->handle);
+		if (len <= 0)
+			break;
+		key = ((key << 5) | (key >> 27)) ^ get_crc32 (buf, len);
+	}
+	zfile_fseek (t->handle, pos, SEEK_SET);
+	xfree (buf);
+	fetch_datapath (path, sizeof path / sizeof (TCHAR));
+	_tcscat (path, _T("cdda"));
+	if (!my_existsdir (path))
+		my_mkdir (path);
+	fixtrailing (path);
+	_stprintf (out, _T("%scdda_%08x_%lld_%d.raw"), path, key, t->filesize, t->enctype);
+	return true;
+}
+
+static bool cdda_cache_load (const TCHAR *name, uae_u8 *data, uae_s64 size)
+{
+	struct zfile *zf = zfile_fopen (name, _T("rb"), ZFD_NONE);
+	bool ok = false;
+	if (!zf)
+		return false;
+	if (zfile_size (zf) == size && zfile_fread (data, 1, size, zf) == size)
+		ok = true;
+	zfile_fclose (zf);
+	if (ok)
+		write_log (_T("IMAGE CDDA: '%s' loaded from cache\n"), name);
+	return ok;
+}
+
+static void cdda_cache_save (const TCHAR *name, uae_u8 *data, uae_s64 size)
+{
+	struct zfile *zf = zfile_fopen (name, _T("wb"), ZFD_NONE);
+	if (!zf)
+		return;
+	if (zfile_fwrite (data, 1, size, zf) != size)
+		write_log (_T("IMAGE CDDA: '%s' cache write failed\n"), name);
+	zfile_fclose (zf);
+}
+
+static void cdda_unpack_track (struct cdtoc *t, mp3decoder **mp3dec, bool playback)
+{
+	TCHAR cachename[MAX_DPATH];
+	bool cache, ok = false;
+	uae_u8 *data;
+
+	if (!t->handle)
+		return;
+	// force unpack if handle points to delayed zipped file
+	uae_s64 pos = zfile_ftell (t->handle);
+	zfile_fseek (t->handle, -1, SEEK_END);
+	uae_u8 b;
+	zfile_fread (&b, 1, 1, t->handle);
+	zfile_fseek (t->handle, pos, SEEK_SET);
+	if (t->data || (t->enctype != AUDENC_MP3 && t->enctype != AUDENC_FLAC))
+		return;
+	data = xcalloc (uae_u8, t->filesize + 2352);
+	if (!data)
+		return;
+	// playback waits until the buffer is published, hashing the
+	// compressed file for the cache key can take a while
+	cache = cdda_cache_name (t, cachename);
+	if (cache && cdda_cache_load (cachename, data, t->filesize)) {
+		t->data = data;
+		t->unpackstate = UNPACK_FILLING;
+		if (playback)
+			cdimage_unpack_active = 1;
+		return;
+	}
+	t->data = data;
+	t->unpackstate = UNPACK_FILLING;
+	if (playback)
+		cdimage_unpack_active = 1;
+	if (t->enctype == AUDENC_MP3) {
+		if (!*mp3dec) {
+			try {
+				*mp3dec = new mp3decoder();
+			} catch (exception) { };
+		}
+		if (*mp3dec)
+			ok = (*mp3dec)->get (t->handle, data, t->filesize) != NULL;
+	} else if (t->enctype == AUDENC_FLAC) {
+		flac_get_data (t);
+		ok = t->writeoffset > 0;
+	}
+	if (ok && cache)
+		cdda_cache_save (cachename, data, t->filesize);
+}
+
 static void *cdda_unpack_func (void *v)
 {
-	cdimage_unpack_thread = 1;
+	smp_comm_pipe *pipe = (smp_comm_pipe*)v;
+	bool playback = pipe == &unpack_pipe[0];
 	mp3decoder *mp3dec = NULL;
 
+	uae_sem_wait (&unpack_sem);
+	cdimage_unpack_thread++;
+	uae_sem_post (&unpack_sem);
+
 	for (;;) {
-		uae_u32 cduidx = read_comm_pipe_u32_blocking (&unpack_pipe);
-		if (cdimage_unpack_thread == 0)
+		uae_u32 job = read_comm_pipe_u32_blocking (pipe);
+		if (job == 0xffffffff)
 			break;
-		uae_u32 tocidx = read_comm_pipe_u32_blocking (&unpack_pipe);
-		struct cdunit *cdu = &cdunits[cduidx];
-		struct cdtoc *t = &cdu->toc[tocidx];
-		if (t->handle) {
-			// force unpack if handle points to delayed zipped file
-			uae_s64 pos = zfile_ftell (t->handle);
-			zfile_fseek (t->handle, -1, SEEK_END);
-			uae_u8 b;
-			zfile_fread (&b, 1, 1, t->handle);
-			zfile_fseek (t->handle, pos, SEEK_SET);
-			if (!t->data && (t->enctype == AUDENC_MP3 || t->enctype == AUDENC_FLAC)) {
-				t->data = xcalloc (uae_u8, t->filesize + 2352);
-				cdimage_unpack_active = 1;
-				if (t->data) {
-					if (t->enctype == AUDENC_MP3) {
-						if (!mp3dec) {
-							try {
-								mp3dec = new mp3decoder();
-							} catch (exception) { };
-						}
-						if (mp3dec)
-							t->data = mp3dec->get (t->handle, t->data, t->filesize);
-					} else if (t->enctype == AUDENC_FLAC) {
-						flac_get_data (t);
-					}
+		struct cdunit *cdu = &cdunits[job >> 8];
+		struct cdtoc *t = &cdu->toc[job & 0xff];
+		if (playback) {
+			// audio_unpack() already claimed the track
+			cdda_unpack_track (t, &mp3dec, true);
+			t->unpackstate = UNPACK_DONE;
+			cdimage_unpack_active = 2;
+		} else {
+			bool go = false;
+			uae_sem_wait (&unpack_sem);
+			if (t->unpackstate == UNPACK_QUEUED) {
+				if (cdimage_unpack_stop) {
+					t->unpackstate = UNPACK_NONE;
+				} else {
+					t->unpackstate = UNPACK_BUSY;
+					go = true;
 				}
 			}
+			uae_sem_post (&unpack_sem);
+			if (go) {
+				cdda_unpack_track (t, &mp3dec, false);
+				t->unpackstate = UNPACK_DONE;
+			}
 		}
-		cdimage_unpack_active = 2;
 	}
 	delete mp3dec;
-	cdimage_unpack_thread = -1;
+	uae_sem_wait (&unpack_sem);
+	cdimage_unpack_thread--;
+	uae_sem_post (&unpack_sem);
 	return 0;
 }
 
 static void audio_unpack (struct cdunit *cdu, struct cdtoc *t)
 {
+	bool claim = false;
+
+	uae_sem_wait (&unpack_sem);
+	if (t->unpackstate == UNPACK_NONE || t->unpackstate == UNPACK_QUEUED) {
+		t->unpackstate = UNPACK_BUSY;
+		claim = true;
+	}
+	uae_sem_post (&unpack_sem);
+	// already decoded or being decoded ahead, wait until the decode
+	// thread has published the buffer
+	if (!claim) {
+		while (t->unpackstate == UNPACK_BUSY)
+			sleep_millis(10);
+		return;
+	}
 	// do this even if audio is not compressed, t->handle also could be
 	// compressed and we want to unpack it in background too
 	while (cdimage_unpack_active == 1)
 		sleep_millis(10);
 	cdimage_unpack_active = 0;
-	write_comm_pipe_u32 (&unpack_pipe, cdu - &cdunits[0], 0);
-	write_comm_pipe_u32 (&unpack_pipe, t - &cdu->toc[0], 1);
+	write_comm_pipe_u32 (&unpack_pipe[0], ((cdu - &cdunits[0]) << 8) | (t - &cdu->toc[0]), 1);
 	while (cdimage_unpack_active == 0)
 		sleep_millis(10);
 }
 
+// decode all compressed audio tracks in background at mount time
+static void audio_unpack_ahead (struct cdunit *cdu)
+{
+	int cnt = 0;
+
+	if (!currprefs.cd_audio_predecode)
+		return;
+	for (int i = 0; i < cdu->tracks; i++) {
+		struct cdtoc *t = &cdu->toc[i];
+		if (!t->handle || (t->enctype != AUDENC_MP3 && t->enctype != AUDENC_FLAC))
+			continue;
+		// tracks sharing one file are left to on demand decoding
+		int j;
+		for (j = 0; j < cdu->tracks; j++) {
+			if (j != i && cdu->toc[j].handle == t->handle)
+				break;
+		}
+		if (j < cdu->tracks)
+			continue;
+		t->unpackstate = UNPACK_QUEUED;
+		write_comm_pipe_u32 (&unpack_pipe[1 + cnt % (CDDA_UNPACK_THREADS - 1)], ((cdu - &cdunits[0]) << 8) | i, 1);
+		cnt++;
+	}
+	if (cnt)
+		write_log (_T("IMAGE CDDA: decoding %d audio tracks ahead\n"), cnt);
+}
+
 static volatile int cda_bufon[2];
 static cda_audio *cda;
 
@@ -867,7 +1088,7 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 				data[13] = tobcd((uae_u8)((address / 75) % 60));
 				data[14] = tobcd((uae_u8)(address % 75));
 				data[15] = 2; /* MODE2 */
-				do_read(cdu, t, data + 16, sector, 0, t->size, false);
+				read_sector (cdu, t, data + 16, sector, 0, t->size, size + 1);
 				sector++;
 				asector++;
 				data += sectorsize;
@@ -877,7 +1098,7 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 			// 2048 -> 2352
 			while (size-- > 0) {
 				memset (data, 0, 16);
-				do_read (cdu, t, data + 16, sector, 0, 2048, false);
+				read_sector (cdu, t, data + 16, sector, 0, 2048, size + 1);
 				encode_l2 (data, sector + 150);
 				sector++;
 				asector++;
@@ -888,8 +1109,8 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 			// 2352 -> 2048
 			while (size-- > 0) {
 				uae_u8 b = 0;
-				do_read (cdu, t, &b, sector, 15, 1, false);
-				do_read (cdu, t, data, sector, b == 2 ? 24 : 16, sectorsize, false);
+				read_sector (cdu, t, &b, sector, 15, 1, size + 1);
+				read_sector (cdu, t, data, sector, b == 2 ? 24 : 16, sectorsize, size + 1);
 				sector++;
 				asector++;
 				data += sectorsize;
@@ -899,10 +1120,10 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 			// 2352 -> 2336
 			while (size-- > 0) {
 				uae_u8 b = 0;
-				do_read (cdu, t, &b, sector, 15, 1, false);
+				read_sector (cdu, t, &b, sector, 15, 1, size + 1);
 				if (b != 2 && b != 0) // MODE0 or MODE2 only allowed
 					return 0;
-				do_read (cdu, t, data, sector, 16, sectorsize, false);
+				read_sector (cdu, t, data, sector, 16, sectorsize, size + 1);
 				sector++;
 				asector++;
 				data += sectorsize;
@@ -911,7 +1132,7 @@ static int command_rawread (int unitnum, uae_u8 *data, int sector, int size, int
 		} else if (sectorsize == t->size) {
 			// no change
 			while (size -- > 0) {
-				do_read (cdu, t, data, sector, 0, sectorsize, false);
+				read_sector (cdu, t, data, sector, 0, sectorsize, size + 1);
 				sector++;
 				asector++;
 				data += sectorsize;
@@ -979,9 +1200,14 @@ static int command_read (int unitnum, uae_u8 *data, int sector, int numsectors)
 	if (!t)
 		return 0;
 	cdda_stop (cdu);
-	if (t->size == 2048) {
+	if (t->size == 2048 && !t->skipsize && t->enctype != ENC_CHD && t->handle && numsectors >= CD_READAHEAD) {
+		// large plain read, straight to the caller's buffer
+		zfile_fseek (t->handle, t->offset + (uae_u64)sector * 2048, SEEK_SET);
+		zfile_fread (data, 1, numsectors * 2048, t->handle);
+		sector += numsectors;
+	} else if (t->size == 2048) {
 		while (numsectors-- > 0) {
-			do_read (cdu, t, data, sector, 0, 2048, false);
+			read_sector (cdu, t, data, sector, 0, 2048, numsectors + 1);
 			data += 2048;
 			sector++;
 		}
@@ -989,12 +1215,12 @@ static int command_read (int unitnum, uae_u8 *data, int sector, int numsectors)
 		while (numsectors-- > 0) {
 			if (t->size == 2352) {
 				uae_u8 b = 0;
-				do_read (cdu, t, &b, sector, 15, 1, false);
+				read_sector (cdu, t, &b, sector, 15, 1, numsectors + 1);
 				// 2 = MODE2
-				do_read (cdu, t, data, sector, b == 2 ? 24 : 16, 2048, false);
+				read_sector (cdu, t, data, sector, b == 2 ? 24 : 16, 2048, numsectors + 1);
 			} else {
 				// 2336
-				do_read (cdu, t, data, sector, 8, 2048, false);
+				read_sector (cdu, t, data, sector, 8, 2048, numsectors + 1);
 			}
 			data += 2048;
 			sector++;
@@ -1945,6 +2171,7 @@ static void unload_image (struct cdunit *cdu)
 		cdu->chd_f->close();
 	cdu->chd_f = NULL;
 #endif
+	rcache_free (cdu);
 	memset (cdu->toc, 0, sizeof cdu->toc);
 	cdu->tracks = 0;
 	cdu->cdsize = 0;
@@ -1967,11 +2194,16 @@ static int open_device (int unitnum, const TCHAR *ident, int flags)
 		cdu->cdda_volume[0] = 0x7fff;
 		cdu->cdda_volume[1] = 0x7fff;
 		if (cdimage_unpack_thread == 0) {
-			init_comm_pipe (&unpack_pipe, 10, 1);
-			uae_start_thread (_T("cdimage_unpack"), cdda_unpack_func, NULL, NULL);
-			while (cdimage_unpack_thread == 0)
+			cdimage_unpack_stop = false;
+			uae_sem_init (&unpack_sem, 0, 1);
+			for (int i = 0; i < CDDA_UNPACK_THREADS; i++) {
+				init_comm_pipe (&unpack_pipe[i], 102, 1);
+				uae_start_thread (i ? _T("cdimage_unpack_ahead") : _T("cdimage_unpack"), cdda_unpack_func, &unpack_pipe[i], NULL);
+			}
+			while (cdimage_unpack_thread < CDDA_UNPACK_THREADS)
 				Sleep (10);
 		}
+		audio_unpack_ahead (cdu);
 		ret = 1;
 	}
 	blkdev_cd_change (unitnum, cdu->imgname);
@@ -1985,13 +2217,16 @@ static void close_device (int unitnum)
 		cdda_stop (cdu);
 		cdu->open = false;
 		if (cdimage_unpack_thread) {
-			cdimage_unpack_thread = 0;
-			write_comm_pipe_u32 (&unpack_pipe, -1, 0);
-			write_comm_pipe_u32 (&unpack_pipe, -1, 1);
-			while (cdimage_unpack_thread == 0)
+			// queued tracks are skipped, tracks being decoded are finished
+			cdimage_unpack_stop = true;
+			for (int i = 0; i < CDDA_UNPACK_THREADS; i++)
+				write_comm_pipe_u32 (&unpack_pipe[i], 0xffffffff, 1);
+			while (cdimage_unpack_thread > 0)
 				Sleep (10);
+			for (int i = 0; i < CDDA_UNPACK_THREADS; i++)
+				destroy_comm_pipe (&unpack_pipe[i]);
+			uae_sem_destroy (&unpack_sem);
 			cdimage_unpack_thread = 0;
-			destroy_comm_pipe (&unpack_pipe);
 		}
 		unload_image (cdu);
 		uae_sem_destroy (&cdu->sub_sem);
@@ -24,9 +24,9 @@
 #include "threaddep/thread.h"
 
 #include "cda_play.h"
+#include "devices.h"
 #include "archivers/mp2/kjmp2.h"
 #include "mpeg2.h"
-#include "mpeg2convert.h"
 
 #define FMV_DEBUG 0
 static int fmv_audio_debug = 0;
@@ -253,12 +253,31 @@ static int cl450_newpacket_offset_read;
 
 static int cl450_frame_rate, cl450_frame_pixbytes;
 static int cl450_frame_width, cl450_frame_height;
+static int cl450_chroma_width, cl450_chroma_height;
 static int cl450_video_hsync_wait;
-static int cl450_videoram_read;
-static int cl450_videoram_write;
-static int cl450_videoram_cnt;
+// frame queue, written by decode thread, read at hsync
+static volatile int cl450_videoram_in, cl450_videoram_out;
+static int cl450_videoram_show = -1;
+static bool cl450_videoram_show_blank;
 static int cl450_frame_cnt;
 
+// MPEG video and MP2 audio are decoded in threads. Decoder state changes
+// that the emulated CL450 reports are queued back to the emulation side.
+#define CL450_EVENTS 16
+#define CL450_EVENT_SEQUENCE 1
+#define CL450_EVENT_GOP 2
+struct cl450_event
+{
+	int type;
+	uae_u16 v[3];
+};
+static struct cl450_event cl450_events[CL450_EVENTS];
+static volatile int cl450_event_in, cl450_event_out;
+static smp_comm_pipe fmv_video_pipe, fmv_audio_pipe;
+static volatile int fmv_video_thread_state, fmv_audio_thread_state;
+static volatile bool cl450_decode_busy, cl450_decode_abort;
+static volatile int fmv_audio_posted, fmv_audio_done;
+
 static uae_u16 l64111_regs[32];
 static uae_u16 l64111intmask[2], l64111intstatus[2];
 #define L64111_CHANNEL_BUFFERS 128
@@ -320,12 +339,13 @@ static bool cl450_checkint(bool enabled)
 	return irq;
 }
 
-void rethink_cd32fmv(void)
+bool rethink_cd32fmv(void)
 {
 	if (!fmv_ram_bank.baseaddr)
-		return;
-	cl450_checkint(true);
-	l64111_checkint(true);
+		return false;
+	bool irq = cl450_checkint(true);
+	irq |= l64111_checkint(true);
+	return irq;
 }
 
 DECLARE_MEMORY_FUNCTIONS(fmv);
@@ -374,7 +394,7 @@ struct zfile *fdump;
 
 struct fmv_pcmaudio
 {
-	bool ready;
+	volatile bool ready;
 	signed short pcm[KJMP2_SAMPLES_PER_FRAME * 2];
 };
 static struct fmv_pcmaudio *pcmaudio;
@@ -383,6 +403,7 @@ static void l64111_set_status(int num, uae_u16 mask)
 {
 	num--;
 	l64111intstatus[num] |= mask;
+	devices_irq_dirty(DEVICE_ID_CD32FMV);
 	l64111_checkint(true);
 }
 
@@ -420,8 +441,6 @@ static int l64111_get_frame(uae_u8 *data, int remaining)
 	if (audio_data_remaining >= 0)
 		audio_data_remaining -= size;
 	if (audio_frame_cnt == audio_frame_size) {
-		int bytes;
-
 		if (pcmaudio[offset].ready) {
 			write_log(_T("L64111 buffer overflow!\n"));
 		}
@@ -431,12 +450,9 @@ static int l64111_get_frame(uae_u8 *data, int remaining)
 
 		zfile_fwrite(memdata, 1, audio_frame_size, fdump);
 #endif
-		bytes = kjmp2_decode_frame(&mp2, memdata, pcmaudio[offset].pcm);
-		if (bytes < 4 || bytes > KJMP2_MAX_FRAME_SIZE) {
-			write_log(_T("mp2 decoding error\n"));
-			memset(pcmaudio[offset].pcm, 0, KJMP2_SAMPLES_PER_FRAME * 4);
-		}
-		pcmaudio[offset].ready = true;
+		// decoded by fmv_audio_thread, sets ready when done
+		fmv_audio_posted++;
+		write_comm_pipe_u32(&fmv_audio_pipe, offset, 1);
 
 		audio_frame_size = 0;
 		audio_frame_cnt = 0;
@@ -532,8 +548,35 @@ static void l64111_init(void)
 	l64111_fifo_cnt = 0;
 }
 
+static void fmv_audio_sync(void)
+{
+	while (fmv_audio_posted != fmv_audio_done)
+		sleep_millis(1);
+}
+
+static void *fmv_audio_thread(void *v)
+{
+	fmv_audio_thread_state = 1;
+	for (;;) {
+		uae_u32 offset = read_comm_pipe_u32_blocking(&fmv_audio_pipe);
+		if (offset == 0xffffffff)
+			break;
+		uae_u8 *memdata = audioram + offset * L64111_CHANNEL_BUFFER_SIZE;
+		int bytes = kjmp2_decode_frame(&mp2, memdata, pcmaudio[offset].pcm);
+		if (bytes < 4 || bytes > KJMP2_MAX_FRAME_SIZE) {
+			write_log(_T("mp2 decoding error\n"));
+			memset(pcmaudio[offset].pcm, 0, KJMP2_SAMPLES_PER_FRAME * 4);
+		}
+		pcmaudio[offset].ready = true;
+		fmv_audio_done++;
+	}
+	fmv_audio_thread_state = -1;
+	return 0;
+}
+
 static void l64111_reset(void)
 {
+	fmv_audio_sync();
 	memset(l64111_regs, 0, sizeof l64111_regs);
 	l64111intmask[0] = l64111intmask[1] = 0;
 	l64111intstatus[0] = l64111intstatus[1] = 0;
@@ -759,9 +802,11 @@ static void l64111_wput (uaecptr addr, uae_u16 v)
 		break;
 	case A_INT1:
 		l64111intmask[0] = v;
+		devices_irq_dirty(DEVICE_ID_CD32FMV);
 		return;
 	case A_INT2:
 		l64111intmask[1] = v;
+		devices_irq_dirty(DEVICE_ID_CD32FMV);
 		return;
 	}
 
@@ -785,6 +830,7 @@ static void cl450_set_status(uae_u16 mask)
 		cl450_hmem[CL_HMEM_INT_STATUS] = cl450_pending_interrupts;
 		cl450_pending_interrupts = 0;
 		cl450_regs[HOST_control] &= ~0x80;
+		devices_irq_dirty(DEVICE_ID_CD32FMV);
 		cl450_checkint(true);
 	}
 }
@@ -801,6 +847,42 @@ static void cl450_write_dram(int addr, uae_u16 w)
 static struct zfile *videodump;
 #endif
 
+static void cl450_post_event(int type, uae_u16 v0, uae_u16 v1, uae_u16 v2)
+{
+	struct cl450_event *ev;
+	if (cl450_event_in - cl450_event_out >= CL450_EVENTS)
+		return;
+	ev = &cl450_events[cl450_event_in & (CL450_EVENTS - 1)];
+	ev->type = type;
+	ev->v[0] = v0;
+	ev->v[1] = v1;
+	ev->v[2] = v2;
+	cl450_event_in++;
+}
+
+static void cl450_handle_events(void)
+{
+	while (cl450_event_out != cl450_event_in) {
+		struct cl450_event *ev = &cl450_events[cl450_event_out & (CL450_EVENTS - 1)];
+		switch (ev->type)
+		{
+			case CL450_EVENT_SEQUENCE:
+				cl450_set_status(CL_INT_SEQ_V);
+				cl450_frame_rate = ev->v[0];
+				cl450_write_dram(CL_DRAM_PICTURE_RATE, ev->v[0]);
+				cl450_write_dram(CL_DRAM_H_SIZE, ev->v[1]);
+				cl450_write_dram(CL_DRAM_V_SIZE, ev->v[2]);
+				break;
+			case CL450_EVENT_GOP:
+				cl450_write_dram(CL_DRAM_TIME_CODE_0, ev->v[0]);
+				cl450_write_dram(CL_DRAM_TIME_CODE_1, ev->v[1]);
+				break;
+		}
+		cl450_event_out++;
+	}
+}
+
+// decode thread side: parse until libmpeg2 wants more data
 static void cl450_parse_frame(void)
 {
 	for (;;) {
@@ -808,80 +890,115 @@ static void cl450_parse_frame(void)
 		switch (mpeg_state)
 		{
 			case STATE_BUFFER:
-			{
-				int bufsize = cl450_buffer_offset;
-				if (bufsize == 0)
-					return;
-				while (bufsize > 0 && cl450_newpacket_mode) {
-					struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
-					if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
-						return;
-					int size = np->length > bufsize ? bufsize : np->length;
-
-					if (np->length == 0) {
-						write_log(_T("CL450 no matching newpacket!?\n"));
-						return;
-					}
-
-					np->length -= size;
-					bufsize -= size;
-					if (np->length > 0)
-						break;
-					//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
-					cl450_newpacket_offset_read++;
-					cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
-				}
-#if DUMP_VIDEO
-				if (!videodump)
-					videodump = zfile_fopen(_T("c:\\temp\\1.mpg"), _T("wb"));
-				zfile_fwrite(&ram[CL450_MPEG_BUFFER], 1, cl450_buffer_offset, videodump);
-#endif
-				memcpy(&fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
-				mpeg2_buffer(mpeg_decoder, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset + cl450_buffer_offset);
-				libmpeg_offset += cl450_buffer_offset;
-				if (libmpeg_offset >= CL450_MPEG_DECODE_BUFFER_SIZE - CL450_MPEG_BUFFER_SIZE)
-					libmpeg_offset = 0;
-				cl450_buffer_offset = 0;
-			}
-			break;
+				return;
 			case STATE_SEQUENCE:
 				cl450_frame_pixbytes = currprefs.color_mode != 5 ? 2 : 4;
-				mpeg2_convert(mpeg_decoder, cl450_frame_pixbytes == 2 ? mpeg2convert_rgb16 : mpeg2convert_rgb32, NULL);
-				cl450_set_status(CL_INT_SEQ_V);
-				cl450_frame_rate = mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0;
 				cl450_frame_width = mpeg_info->sequence->width;
 				cl450_frame_height = mpeg_info->sequence->height;
-				cl450_write_dram(CL_DRAM_PICTURE_RATE, cl450_frame_rate);
-				cl450_write_dram(CL_DRAM_H_SIZE, cl450_frame_width);
-				cl450_write_dram(CL_DRAM_V_SIZE, cl450_frame_height);
+				cl450_chroma_width = mpeg_info->sequence->chroma_width;
+				cl450_chroma_height = mpeg_info->sequence->chroma_height;
+				cl450_post_event(CL450_EVENT_SEQUENCE,
+					mpeg_info->sequence->frame_period ? 27000000 / mpeg_info->sequence->frame_period : 0,
+					cl450_frame_width, cl450_frame_height);
 				break;
 			case STATE_PICTURE:
 				break;
 			case STATE_GOP:
-				cl450_write_dram(CL_DRAM_TIME_CODE_0, (mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes));
-				cl450_write_dram(CL_DRAM_TIME_CODE_1, (mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures));
+				cl450_post_event(CL450_EVENT_GOP,
+					(mpeg_info->gop->hours << 6) | (mpeg_info->gop->minutes),
+					(mpeg_info->gop->seconds << 6) | (mpeg_info->gop->pictures), 0);
 				break;
 			case STATE_SLICE:
 			case STATE_END:
 				if (mpeg_info->display_fbuf) {
-					memcpy(videoram[cl450_videoram_write].data, mpeg_info->display_fbuf->buf[0], cl450_frame_width * cl450_frame_height * cl450_frame_pixbytes);
-					videoram[cl450_videoram_write].width = cl450_frame_width;
-					videoram[cl450_videoram_write].height = cl450_frame_height;
-					videoram[cl450_videoram_write].depth = cl450_frame_pixbytes;
-					cl450_videoram_write++;
-					cl450_videoram_write &= CL450_VIDEO_BUFFERS - 1;
-					cl450_videoram_cnt++;
-					//write_log(_T("%d\n"), cl450_videoram_cnt);
+					// bounded queue, wait until emulation side shows a frame
+					while (cl450_videoram_in - cl450_videoram_out >= CL450_VIDEO_BUFFERS - 1 && !cl450_decode_abort)
+						sleep_millis(1);
+					if (cl450_decode_abort)
+						return;
+					struct cl450_videoram *vr = &videoram[cl450_videoram_in & (CL450_VIDEO_BUFFERS - 1)];
+					cd32_fmv_yuv_to_rgb(vr->data, mpeg_info->display_fbuf->buf[0], mpeg_info->display_fbuf->buf[1], mpeg_info->display_fbuf->buf[2],
+						cl450_frame_width, cl450_frame_height, cl450_chroma_width, cl450_chroma_height, cl450_frame_pixbytes);
+					vr->width = cl450_frame_width;
+					vr->height = cl450_frame_height;
+					vr->depth = cl450_frame_pixbytes;
+					cl450_videoram_in++;
 				}
-				return;
+				break;
 			default:
 				break;
 		}
 	}
 }
 
+static void *fmv_video_thread(void *v)
+{
+	fmv_video_thread_state = 1;
+	for (;;) {
+		uae_u32 offset = read_comm_pipe_u32_blocking(&fmv_video_pipe);
+		if (offset == 0xffffffff)
+			break;
+		uae_u32 len = read_comm_pipe_u32_blocking(&fmv_video_pipe);
+		uae_u8 *p = &fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + offset;
+		mpeg2_buffer(mpeg_decoder, p, p + len);
+		cl450_parse_frame();
+		cl450_decode_busy = false;
+	}
+	fmv_video_thread_state = -1;
+	return 0;
+}
+
+static void cl450_decode_sync(void)
+{
+	cl450_decode_abort = true;
+	while (cl450_decode_busy)
+		sleep_millis(1);
+	cl450_decode_abort = false;
+}
+
+// emulation side: pass buffered stream data to decode thread
+static void cl450_feed(void)
+{
+	int bufsize = cl450_buffer_offset;
+	if (bufsize == 0)
+		return;
+	while (bufsize > 0 && cl450_newpacket_mode) {
+		struct cl450_newpacket *np = &cl450_newpacket_buffer[cl450_newpacket_offset_read];
+		if (cl450_newpacket_offset_read == cl450_newpacket_offset_write)
+			return;
+		int size = np->length > bufsize ? bufsize : np->length;
+
+		if (np->length == 0) {
+			write_log(_T("CL450 no matching newpacket!?\n"));
+			return;
+		}
+
+		np->length -= size;
+		bufsize -= size;
+		if (np->length > 0)
+			break;
+		//write_log(_T("CL450: NewPacket %d done\n"), cl450_newpacket_offset_read);
+		cl450_newpacket_offset_read++;
+		cl450_newpacket_offset_read &= CL450_NEWPACKET_BUFFER_SIZE - 1;
+	}
+#if DUMP_VIDEO
+	if (!videodump)
+		videodump = zfile_fopen(_T("c:\\temp\\1.mpg"), _T("wb"));
+	zfile_fwrite(&ram[CL450_MPEG_BUFFER], 1, cl450_buffer_offset, videodump);
+#endif
+	memcpy(&fmv_ram_bank.baseaddr[CL450_MPEG_DECODE_BUFFER] + libmpeg_offset, &fmv_ram_bank.baseaddr[CL450_MPEG_BUFFER], cl450_buffer_offset);
+	cl450_decode_busy = true;
+	write_comm_pipe_u32(&fmv_video_pipe, libmpeg_offset, 0);
+	write_comm_pipe_u32(&fmv_video_pipe, cl450_buffer_offset, 1);
+	libmpeg_offset += cl450_buffer_offset;
+	if (libmpeg_offset >= CL450_MPEG_DECODE_BUFFER_SIZE - CL450_MPEG_BUFFER_SIZE)
+		libmpeg_offset = 0;
+	cl450_buffer_offset = 0;
+}
+
 static void cl450_reset(void)
 {
+	cl450_decode_sync();
 	cl450_play = 0;
 	cl450_pending_interrupts = 0;
 	cl450_interruptmask = 0;
@@ -894,9 +1011,11 @@ static void cl450_reset(void)
 	cl450_newpacket_mode = false;
 	cl450_newpacket_offset_write = 0;
 	cl450_newpacket_offset_read = 0;
-	cl450_videoram_write = 0;
-	cl450_videoram_read = 0;
-	cl450_videoram_cnt = 0;
+	cl450_videoram_in = 0;
+	cl450_videoram_out = 0;
+	cl450_videoram_show = -1;
+	cl450_event_in = 0;
+	cl450_event_out = 0;
 	memset(cl450_regs, 0, sizeof cl450_regs);
 	if (mpeg_decoder)
 		mpeg2_reset(mpeg_decoder, 1);
@@ -1139,6 +1258,8 @@ static void cl450_wput(uaecptr addr, uae_u16 v)
 
 	if (fmv_video_debug & 2)
 		write_log(_T("CL450 write reg %02x %04x\n"), addr, v);
+	// HOST_control and CPU_control gate the interrupt
+	devices_irq_dirty(DEVICE_ID_CD32FMV);
 
 	switch (addr)
 	{
@@ -1394,6 +1515,11 @@ void fmv_next_cd_audio_buffer_callback(int bufnum)
 
 void cd32_fmv_vsync_handler(void)
 {
+	if (!videoram || cl450_videoram_show < 0)
+		return;
+	struct cl450_videoram *vr = &videoram[cl450_videoram_show];
+	cd32_fmv_new_image(vr->width, vr->height, vr->depth, cl450_videoram_show_blank ? NULL : vr->data);
+	cl450_videoram_show = -1;
 }
 
 static void cd32_fmv_audio_handler(void)
@@ -1469,16 +1595,18 @@ void cd32_fmv_hsync_handler(void)
 	if (cl450_play > 0)
 		cl450_scr += 90000.0 / (hblank_hz / fmv_syncadjust);
 
+	cl450_handle_events();
+
 	if (cl450_video_hsync_wait > 0)
 		cl450_video_hsync_wait--;
 	if (cl450_video_hsync_wait == 0) {
 		cl450_set_status(CL_INT_PIC_D);
-		if (cl450_videoram_cnt > 0) {
-			cd32_fmv_new_image(videoram[cl450_videoram_read].width, videoram[cl450_videoram_read].height, 
-				videoram[cl450_videoram_read].depth, cl450_blank ? NULL : videoram[cl450_videoram_read].data);
-			cl450_videoram_read++;
-			cl450_videoram_read &= CL450_VIDEO_BUFFERS - 1;
-			cl450_videoram_cnt--;
+		if (cl450_videoram_in - cl450_videoram_out > 0) {
+			// passed to genlock at vsync, decode thread can't reuse
+			// this buffer until next frame is taken from the queue.
+			cl450_videoram_show = cl450_videoram_out & (CL450_VIDEO_BUFFERS - 1);
+			cl450_videoram_show_blank = cl450_blank != 0;
+			cl450_videoram_out++;
 		}
 		cl450_video_hsync_wait = max_sync_vpos;
 		while (remaining_sync_vpos >= 1.0) {
@@ -1505,8 +1633,8 @@ void cd32_fmv_hsync_handler(void)
 				cl450_set_status(CL_INT_RDY);
 		}
 
-		if (cl450_buffer_offset >= 512 && cl450_videoram_cnt < CL450_VIDEO_BUFFERS - 1) {
-			cl450_parse_frame();
+		if (cl450_buffer_offset >= 512 && !cl450_decode_busy && cl450_videoram_in - cl450_videoram_out < CL450_VIDEO_BUFFERS - 1) {
+			cl450_feed();
 		}
 	}
 }
@@ -1519,8 +1647,31 @@ void cd32_fmv_reset(void)
 	cd32_fmv_state(0);
 }
 
+static void fmv_stop_threads(void)
+{
+	if (fmv_video_thread_state > 0) {
+		cl450_decode_abort = true;
+		write_comm_pipe_u32(&fmv_video_pipe, 0xffffffff, 1);
+		while (fmv_video_thread_state > 0)
+			sleep_millis(1);
+		destroy_comm_pipe(&fmv_video_pipe);
+		cl450_decode_busy = false;
+		cl450_decode_abort = false;
+	}
+	fmv_video_thread_state = 0;
+	if (fmv_audio_thread_state > 0) {
+		write_comm_pipe_u32(&fmv_audio_pipe, 0xffffffff, 1);
+		while (fmv_audio_thread_state > 0)
+			sleep_millis(1);
+		destroy_comm_pipe(&fmv_audio_pipe);
+	}
+	fmv_audio_thread_state = 0;
+	fmv_audio_posted = fmv_audio_done = 0;
+}
+
 void cd32_fmv_free(void)
 {
+	fmv_stop_threads();
 	mapped_free(&fmv_rom_bank);
 	mapped_free(&fmv_ram_bank);
 	xfree(audioram);
@@ -1545,6 +1696,7 @@ void cd32_fmv_free(void)
 	mpeg_decoder = NULL;
 	cl450_reset();
 	l64111_reset();
+	cd32_fmv_genlock_free();
 }
 
 addrbank *cd32_fmv_init (uaecptr start)
@@ -1601,6 +1753,12 @@ addrbank *cd32_fmv_init (uaecptr start)
 		mpeg_decoder = mpeg2_init();
 		mpeg_info = mpeg2_info(mpeg_decoder);
 	}
+	init_comm_pipe(&fmv_video_pipe, 10, 1);
+	init_comm_pipe(&fmv_audio_pipe, L64111_CHANNEL_BUFFERS + 2, 1);
+	uae_start_thread(_T("cd32fmv_video"), fmv_video_thread, NULL, NULL);
+	uae_start_thread(_T("cd32fmv_audio"), fmv_audio_thread, NULL, NULL);
+	while (fmv_video_thread_state == 0 || fmv_audio_thread_state == 0)
+		sleep_millis(1);
 
 	fmv_bank.mask = fmv_board_size - 1;
 	map_banks(&fmv_rom_bank, (fmv_start + ROM_BASE) >> 16, fmv_rom_size >> 16, 0);
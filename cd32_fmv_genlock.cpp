@@ -12,14 +12,24 @@
 
 #include "options.h"
 #include "memory.h"
+#include "events.h"
 #include "cd32_fmv.h"
 #include "xwin.h"
+#include "threaddep/thread.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GENLOCK_SSE2 1
+#include <emmintrin.h>
+#endif
 
 static uae_u8 *mpeg_out_buffer;
 static int mpeg_width, mpeg_height, mpeg_depth;
 static uae_u32 fmv_border_color;
 static uae_u16 fmv_border_color_16;
 int cd32_fmv_active;
+static int genlock_simd = 1;
+static uae_u8 *genlock_row;
+static int genlock_row_size;
 
 // According to schematics there is at least 3 (possible more)
 // "genlock modes" but they seem to be unused, at least ROM
@@ -63,10 +73,225 @@ void cd32_fmv_state(int state)
 	cd32_fmv_active = state;
 }
 
-// slow software method but who cares.
+/* YUV to RGB, ITU-R 601 limited range in 6 bit fixed point. Chroma is
+ * horizontally subsampled (4:2:0 or 4:2:2). SSE2 uses saturating adds,
+ * results only saturate where C version clamps anyway.
+ */
+#define YUV_Y 74
+#define YUV_RV 102
+#define YUV_GU 25
+#define YUV_GV 52
+#define YUV_BU 129
+
+// one decoded frame captured for the benchmark, shared with the decode thread
+static uae_u8 *yuv_rec;
+static int yuv_rec_w, yuv_rec_h, yuv_rec_cw, yuv_rec_ch;
+static volatile bool yuv_record;
+static uae_sem_t yuv_rec_sem;
+
+STATIC_INLINE int yuv_clamp(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static void yuv_row_c(const uae_u8 *y, const uae_u8 *u, const uae_u8 *v, uae_u8 *d, int x, int w, int depth)
+{
+	for (; x < w; x++) {
+		int yy = (y[x] - 16) * YUV_Y + 32;
+		int uu = u[x >> 1] - 128;
+		int vv = v[x >> 1] - 128;
+		int r = yuv_clamp((yy + YUV_RV * vv) >> 6);
+		int g = yuv_clamp((yy - YUV_GU * uu - YUV_GV * vv) >> 6);
+		int b = yuv_clamp((yy + YUV_BU * uu) >> 6);
+		if (depth == MPEG_PIXBYTES_32)
+			((uae_u32*)d)[x] = (r << 16) | (g << 8) | b;
+		else
+			((uae_u16*)d)[x] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+	}
+}
 
+#if GENLOCK_SSE2
+static int yuv_row_sse2(const uae_u8 *y, const uae_u8 *u, const uae_u8 *v, uae_u8 *d, int w, int depth)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c16 = _mm_set1_epi16(16);
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i c32 = _mm_set1_epi16(32);
+	const __m128i cy = _mm_set1_epi16(YUV_Y);
+	const __m128i crv = _mm_set1_epi16(YUV_RV);
+	const __m128i cgu = _mm_set1_epi16(YUV_GU);
+	const __m128i cgv = _mm_set1_epi16(YUV_GV);
+	const __m128i cbu = _mm_set1_epi16(YUV_BU);
+	int x;
+
+	for (x = 0; x + 8 <= w; x += 8) {
+		__m128i yv = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(y + x)), zero);
+		__m128i uv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(int*)(u + x / 2)), zero);
+		__m128i vv = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(int*)(v + x / 2)), zero);
+		uv = _mm_sub_epi16(_mm_unpacklo_epi16(uv, uv), c128);
+		vv = _mm_sub_epi16(_mm_unpacklo_epi16(vv, vv), c128);
+		yv = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(yv, c16), cy), c32);
+		__m128i r = _mm_srai_epi16(_mm_adds_epi16(yv, _mm_mullo_epi16(vv, crv)), 6);
+		__m128i g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(yv, _mm_mullo_epi16(uv, cgu)), _mm_mullo_epi16(vv, cgv)), 6);
+		__m128i b = _mm_srai_epi16(_mm_adds_epi16(yv, _mm_mullo_epi16(uv, cbu)), 6);
+		r = _mm_packus_epi16(r, r);
+		g = _mm_packus_epi16(g, g);
+		b = _mm_packus_epi16(b, b);
+		if (depth == MPEG_PIXBYTES_32) {
+			__m128i bg = _mm_unpacklo_epi8(b, g);
+			__m128i r0 = _mm_unpacklo_epi8(r, zero);
+			_mm_storeu_si128((__m128i*)(d + x * 4), _mm_unpacklo_epi16(bg, r0));
+			_mm_storeu_si128((__m128i*)(d + x * 4 + 16), _mm_unpackhi_epi16(bg, r0));
+		} else {
+			r = _mm_slli_epi16(_mm_and_si128(_mm_unpacklo_epi8(r, zero), _mm_set1_epi16(0xf8)), 8);
+			g = _mm_slli_epi16(_mm_and_si128(_mm_unpacklo_epi8(g, zero), _mm_set1_epi16(0xfc)), 3);
+			b = _mm_srli_epi16(_mm_unpacklo_epi8(b, zero), 3);
+			_mm_storeu_si128((__m128i*)(d + x * 2), _mm_or_si128(_mm_or_si128(r, g), b));
+		}
+	}
+	return x;
+}
+#endif
+
+static void yuv_convert(uae_u8 *dst, const uae_u8 *y, const uae_u8 *u, const uae_u8 *v, int w, int h, int cw, int ch, int depth)
+{
+	for (int yy = 0; yy < h; yy++) {
+		int cy = ch < h ? yy >> 1 : yy;
+		const uae_u8 *ys = y + yy * w;
+		const uae_u8 *us = u + cy * cw;
+		const uae_u8 *vs = v + cy * cw;
+		uae_u8 *d = dst + yy * w * depth;
+		int x = 0;
+#if GENLOCK_SSE2
+		if (genlock_simd)
+			x = yuv_row_sse2(ys, us, vs, d, w, depth);
+#endif
+		yuv_row_c(ys, us, vs, d, x, w, depth);
+	}
+}
+
+void cd32_fmv_yuv_to_rgb(uae_u8 *dst, const uae_u8 *y, const uae_u8 *u, const uae_u8 *v, int w, int h, int cw, int ch, int depth)
+{
+	if (yuv_record && w <= MAX_MPEG_WIDTH && h <= MAX_MPEG_HEIGHT) {
+		uae_sem_wait(&yuv_rec_sem);
+		if (yuv_record) {
+			if (!yuv_rec)
+				yuv_rec = xmalloc(uae_u8, MAX_MPEG_WIDTH * MAX_MPEG_HEIGHT * 3);
+			memcpy(yuv_rec, y, w * h);
+			memcpy(yuv_rec + w * h, u, cw * ch);
+			memcpy(yuv_rec + w * h + cw * ch, v, cw * ch);
+			yuv_rec_w = w;
+			yuv_rec_h = h;
+			yuv_rec_cw = cw;
+			yuv_rec_ch = ch;
+			yuv_record = false;
+		}
+		uae_sem_post(&yuv_rec_sem);
+	}
+	yuv_convert(dst, y, u, v, w, h, cw, ch, depth);
+}
+
+static uae_u8 *genlock_getrow(int bytes)
+{
+	if (bytes > genlock_row_size) {
+		xfree(genlock_row);
+		genlock_row = xmalloc(uae_u8, bytes);
+		genlock_row_size = bytes;
+	}
+	return genlock_row;
+}
+
+// keyed select of one output scanline, fmv row is already scaled
+static void genlock_row_32(uae_u32 *d32, const uae_u8 *s8, const uae_u32 *fmv, int w, int d)
+{
+	int x = 0;
+#if GENLOCK_SSE2
+	if (genlock_simd && d == 4) {
+		const __m128i keymask = _mm_set1_epi32(0xff);
+		const __m128i key = _mm_set1_epi32(GENLOCK_VAL_32 - 1);
+		for (; x + 4 <= w; x += 4) {
+			__m128i a = _mm_loadu_si128((__m128i*)(s8 + x * 4));
+			__m128i f = _mm_loadu_si128((__m128i*)(fmv + x));
+			__m128i m = _mm_cmpgt_epi32(_mm_and_si128(a, keymask), key);
+			_mm_storeu_si128((__m128i*)(d32 + x), _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, f)));
+		}
+	}
+#endif
+	for (; x < w; x++) {
+		const uae_u8 *p = s8 + x * d;
+		d32[x] = p[0] >= GENLOCK_VAL_32 ? *((uae_u32*)p) : fmv[x];
+	}
+}
+
+static void genlock_row_16(uae_u16 *d16, const uae_u8 *s8, const uae_u16 *fmv, int w, int d)
+{
+	int x = 0;
+#if GENLOCK_SSE2
+	if (genlock_simd && d == 2) {
+		const __m128i key = _mm_set1_epi16(GENLOCK_VAL_16 - 1);
+		for (; x + 8 <= w; x += 8) {
+			__m128i a = _mm_loadu_si128((__m128i*)(s8 + x * 2));
+			__m128i f = _mm_loadu_si128((__m128i*)(fmv + x));
+			__m128i m = _mm_cmpgt_epi16(_mm_srli_epi16(a, 11), key);
+			_mm_storeu_si128((__m128i*)(d16 + x), _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, f)));
+		}
+	}
+#endif
+	for (; x < w; x++) {
+		uae_u16 v = *((uae_u16*)(s8 + x * d));
+		d16[x] = (v >> 11) >= GENLOCK_VAL_16 ? v : fmv[x];
+	}
+}
 
 static void genlock_32(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+{
+	int rw = (w + mult - 1) / mult * mult;
+	uae_u32 *row = (uae_u32*)genlock_getrow(rw * 4);
+	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
+		uae_u32 *srcp = NULL;
+		if (sh >= 0 && sh < mpeg_height)
+			srcp = (uae_u32*)(mpeg_out_buffer + sh * mpeg_width * MPEG_PIXBYTES_32);
+		for (int ww = 0, sw = -hoffset; ww < w; sw++, ww += mult) {
+			uae_u32 sv = fmv_border_color;
+			if (sw >= 0 && sw < mpeg_width && srcp)
+				sv = srcp[sw];
+			for (int w2 = 0; w2 < mult; w2++)
+				row[ww + w2] = sv;
+		}
+		for (int h2 = 0; h2 < mult; h2++) {
+			uae_u32 *d32 = (uae_u32*)(vbout->bufmem + vbout->rowbytes * (hh + h2 + voffset));
+			uae_u8 *s8 = vbin->bufmem + vbin->rowbytes * (hh + h2 + voffset);
+			genlock_row_32(d32, s8, row, rw, d);
+		}
+	}
+}
+
+static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+{
+	int rw = (w + mult - 1) / mult * mult;
+	uae_u16 *row = (uae_u16*)genlock_getrow(rw * 2);
+	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
+		uae_u16 *srcp = NULL;
+		if (sh >= 0 && sh < mpeg_height)
+			srcp = (uae_u16*)(mpeg_out_buffer + sh * mpeg_width * MPEG_PIXBYTES_16);
+		for (int ww = 0, sw = -hoffset; ww < w; sw++, ww += mult) {
+			uae_u16 sv = fmv_border_color_16;
+			if (sw >= 0 && sw < mpeg_width && srcp)
+				sv = srcp[sw];
+			for (int w2 = 0; w2 < mult; w2++)
+				row[ww + w2] = sv;
+		}
+		for (int h2 = 0; h2 < mult; h2++) {
+			uae_u16 *d16 = (uae_u16*)(vbout->bufmem + vbout->rowbytes * (hh + h2 + voffset));
+			uae_u8 *s8 = vbin->bufmem + vbin->rowbytes * (hh + h2 + voffset);
+			genlock_row_16(d16, s8, row, rw, d);
+		}
+	}
+}
+
+// per pixel reference versions, used by benchmark
+
+static void genlock_32_c(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
 {
 	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
 		for (int h2 = 0; h2 < mult; h2++) {
@@ -95,7 +320,7 @@ static void genlock_32(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, i
 	}
 }
 
-static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
+static void genlock_16_c(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, int h, int d, int hoffset, int voffset, int mult)
 {
 	for (int hh = 0, sh = -voffset; hh < h; sh++, hh += mult) {
 		for (int h2 = 0; h2 < mult; h2++) {
@@ -124,16 +349,13 @@ static void genlock_16(struct vidbuffer *vbin, struct vidbuffer *vbout, int w, i
 	}
 }
 
-void cd32_fmv_genlock(struct vidbuffer *vbin, struct vidbuffer *vbout)
+static void genlock_do(struct vidbuffer *vbin, struct vidbuffer *vbout, bool ref)
 {
 	int hoffset, voffset, mult;
 	int w = vbin->outwidth;
 	int h = vbin->outheight;
 	int d = vbin->pixbytes;
 
-	if (!mpeg_out_buffer)
-		return;
-
 	mult = 1;
 	for (;;) {
 		if (mult < 4 && mpeg_width * (mult << 1) <= w + 8 && mpeg_height * (mult << 1) <= h + 8) {
@@ -152,8 +374,139 @@ void cd32_fmv_genlock(struct vidbuffer *vbin, struct vidbuffer *vbout)
 	if (voffset < 0)
 		voffset = 0;
 
-	if (mpeg_depth == 2)
-		genlock_16(vbin, vbout, w, h, d, hoffset, voffset, mult);
-	else
-		genlock_32(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	if (ref) {
+		if (mpeg_depth == 2)
+			genlock_16_c(vbin, vbout, w, h, d, hoffset, voffset, mult);
+		else
+			genlock_32_c(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	} else {
+		if (mpeg_depth == 2)
+			genlock_16(vbin, vbout, w, h, d, hoffset, voffset, mult);
+		else
+			genlock_32(vbin, vbout, w, h, d, hoffset, voffset, mult);
+	}
+}
+
+void cd32_fmv_genlock(struct vidbuffer *vbin, struct vidbuffer *vbout)
+{
+	if (!mpeg_out_buffer)
+		return;
+	genlock_do(vbin, vbout, false);
+}
+
+#define FMVBENCH_WIDTH 720
+#define FMVBENCH_HEIGHT 568
+
+// YUV conversion and genlock speed, recorded frames if available
+void cd32_fmv_benchmark(int loops)
+{
+	int w, h, cw, ch;
+	uae_u8 *yuv, *rgb[2], *out[2];
+	struct vidbuffer vbin, vbout;
+	uae_u32 seed = 0x12345678;
+	int errors = 0;
+	bool recorded;
+	frame_time_t t;
+
+	if (loops <= 0)
+		loops = 100;
+	if (!yuv_rec_sem)
+		uae_sem_init(&yuv_rec_sem, 0, 1);
+	// copy the last captured frame, capture a new one for the next run
+	uae_sem_wait(&yuv_rec_sem);
+	recorded = yuv_rec != NULL;
+	if (recorded) {
+		w = yuv_rec_w;
+		h = yuv_rec_h;
+		cw = yuv_rec_cw;
+		ch = yuv_rec_ch;
+		yuv = xmalloc(uae_u8, w * h + cw * ch * 2);
+		memcpy(yuv, yuv_rec, w * h + cw * ch * 2);
+	}
+	yuv_record = true;
+	uae_sem_post(&yuv_rec_sem);
+	if (!recorded) {
+		w = MAX_MPEG_WIDTH;
+		h = MAX_MPEG_HEIGHT;
+		cw = w / 2;
+		ch = h / 2;
+		yuv = xmalloc(uae_u8, w * h + cw * ch * 2);
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				seed = seed * 1103515245 + 12345;
+				yuv[y * w + x] = (uae_u8)(x + y + (seed >> 29));
+			}
+		}
+		for (int i = 0; i < cw * ch * 2; i++) {
+			seed = seed * 1103515245 + 12345;
+			yuv[w * h + i] = (uae_u8)(seed >> 16);
+		}
+	}
+	console_out_f(_T("%s frame %dx%d\n"), recorded ? _T("Recorded") : _T("Synthetic"), w, h);
+
+	for (int depth = MPEG_PIXBYTES_16; depth <= MPEG_PIXBYTES_32; depth += 2) {
+		for (int mode = 0; mode < 2; mode++) {
+			rgb[mode] = xcalloc(uae_u8, w * h * depth);
+			genlock_simd = mode;
+			t = read_processor_time();
+			for (int l = 0; l < loops; l++)
+				yuv_convert(rgb[mode], yuv, yuv + w * h, yuv + w * h + cw * ch, w, h, cw, ch, depth);
+			t = read_processor_time() - t;
+			console_out_f(_T("YUV %d-bit %s: %.1f frames/s\n"), depth * 8, mode ? _T("SIMD") : _T("C"),
+				t > 0 ? (double)loops * syncbase / t : 0.0);
+		}
+		if (memcmp(rgb[0], rgb[1], w * h * depth))
+			errors++;
+		xfree(rgb[0]);
+		xfree(rgb[1]);
+	}
+	genlock_simd = 1;
+
+	if (!mpeg_out_buffer || !mpeg_depth) {
+		uae_u8 *tmp = xmalloc(uae_u8, w * h * MPEG_PIXBYTES_32);
+		yuv_convert(tmp, yuv, yuv + w * h, yuv + w * h + cw * ch, w, h, cw, ch, MPEG_PIXBYTES_32);
+		cd32_fmv_new_image(w, h, MPEG_PIXBYTES_32, tmp);
+		xfree(tmp);
+	}
+	memset(&vbin, 0, sizeof vbin);
+	memset(&vbout, 0, sizeof vbout);
+	vbin.pixbytes = vbout.pixbytes = mpeg_depth;
+	vbin.outwidth = vbout.outwidth = FMVBENCH_WIDTH;
+	vbin.outheight = vbout.outheight = FMVBENCH_HEIGHT;
+	vbin.rowbytes = vbout.rowbytes = FMVBENCH_WIDTH * mpeg_depth;
+	vbin.bufmem = xmalloc(uae_u8, FMVBENCH_WIDTH * FMVBENCH_HEIGHT * mpeg_depth);
+	// key set on every other 16 pixel span
+	for (int i = 0; i < FMVBENCH_WIDTH * FMVBENCH_HEIGHT * mpeg_depth; i++) {
+		seed = seed * 1103515245 + 12345;
+		vbin.bufmem[i] = ((i / mpeg_depth) & 16) ? (uae_u8)(seed >> 16) | 0xf8 : (uae_u8)(seed >> 16) & 0x07;
+	}
+	for (int mode = 0; mode < 2; mode++) {
+		out[mode] = xcalloc(uae_u8, FMVBENCH_WIDTH * FMVBENCH_HEIGHT * mpeg_depth);
+		vbout.bufmem = out[mode];
+		t = read_processor_time();
+		for (int l = 0; l < loops; l++)
+			genlock_do(&vbin, &vbout, mode == 0);
+		t = read_processor_time() - t;
+		console_out_f(_T("Genlock %d-bit %s: %.1f frames/s\n"), mpeg_depth * 8, mode ? _T("scanline") : _T("per pixel"),
+			t > 0 ? (double)loops * syncbase / t : 0.0);
+	}
+	if (memcmp(out[0], out[1], FMVBENCH_WIDTH * FMVBENCH_HEIGHT * mpeg_depth))
+		errors++;
+	xfree(out[0]);
+	xfree(out[1]);
+	xfree(vbin.bufmem);
+	xfree(yuv);
+	console_out_f(_T("%d errors.\n"), errors);
+}
+
+// decode thread is already stopped
+void cd32_fmv_genlock_free(void)
+{
+	yuv_record = false;
+	xfree(yuv_rec);
+	yuv_rec = NULL;
+	xfree(genlock_row);
+	genlock_row = NULL;
+	genlock_row_size = 0;
+	uae_sem_destroy(&yuv_rec_sem);
 }
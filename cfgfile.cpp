@@ -1157,6 +1157,9 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write (f, _T("floppy_volume"), _T("%d"), p->dfxclickvolume);
 	cfgfile_dwrite (f, _T("floppy_channel_mask"), _T("0x%x"), p->dfxclickchannelmask);
 	cfgfile_write (f, _T("cd_speed"), _T("%d"), p->cd_speed);
+	cfgfile_dwrite (f, _T("cd_block_cache"), _T("%d"), p->cd_block_cache);
+	cfgfile_dwrite_bool (f, _T("cd_audio_predecode"), p->cd_audio_predecode);
+	cfgfile_dwrite_bool (f, _T("cd_audio_cache"), p->cd_audio_cache);
 	cfgfile_write_bool (f, _T("parallel_on_demand"), p->parallel_demand);
 	cfgfile_write_bool (f, _T("serial_on_demand"), p->serial_demand);
 	cfgfile_write_bool (f, _T("serial_hardware_ctsrts"), p->serial_hwctsrts);
@@ -1613,6 +1616,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write_bool (f, _T("cpu_cycle_exact"), p->cpu_cycle_exact);
 	cfgfile_write_bool (f, _T("blitter_cycle_exact"), p->blitter_cycle_exact);
 	cfgfile_write_bool (f, _T("cycle_exact"), p->cpu_cycle_exact && p->blitter_cycle_exact ? 1 : 0);
+	cfgfile_dwrite_bool (f, _T("cpu_cycle_exact_adaptive"), p->cpu_cycle_exact_adaptive);
 	cfgfile_dwrite_bool (f, _T("fpu_no_unimplemented"), p->fpu_no_unimplemented);
 	cfgfile_dwrite_bool (f, _T("cpu_no_unimplemented"), p->int_no_unimplemented);
 	cfgfile_write_bool (f, _T("fpu_strict"), p->fpu_strict);
@@ -3830,6 +3834,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 	if (cfgfile_yesno (option, value, _T("immediate_blits"), &p->immediate_blits)
 		|| cfgfile_yesno (option, value, _T("fpu_no_unimplemented"), &p->fpu_no_unimplemented)
 		|| cfgfile_yesno (option, value, _T("cpu_no_unimplemented"), &p->int_no_unimplemented)
+		|| cfgfile_yesno (option, value, _T("cpu_cycle_exact_adaptive"), &p->cpu_cycle_exact_adaptive)
 		|| cfgfile_yesno (option, value, _T("cd32cd"), &p->cs_cd32cd)
 		|| cfgfile_yesno (option, value, _T("cd32c2p"), &p->cs_cd32c2p)
 		|| cfgfile_yesno(option, value, _T("cd32nvram"), &p->cs_cd32nvram)
@@ -3881,6 +3886,8 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_yesno (option, value, _T("comp_lowopt"), &p->comp_lowopt)
 		|| cfgfile_yesno (option, value, _T("rtg_nocustom"), &p->picasso96_nocustom)
 		|| cfgfile_yesno (option, value, _T("floppy_write_protect"), &p->floppy_read_only)
+		|| cfgfile_yesno (option, value, _T("cd_audio_predecode"), &p->cd_audio_predecode)
+		|| cfgfile_yesno (option, value, _T("cd_audio_cache"), &p->cd_audio_cache)
 		|| cfgfile_yesno (option, value, _T("uae_hide_autoconfig"), &p->uae_hide_autoconfig)
 		|| cfgfile_yesno (option, value, _T("toccata"), &p->sound_toccata)
 		|| cfgfile_yesno (option, value, _T("toccata_mixer"), &p->sound_toccata_mixer)
@@ -3917,6 +3924,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_intval(option, value, _T("rtg_modes"), &p->picasso96_modeflags, 1)
 		|| cfgfile_intval (option, value, _T("floppy_speed"), &p->floppy_speed, 1)
 		|| cfgfile_intval (option, value, _T("cd_speed"), &p->cd_speed, 1)
+		|| cfgfile_intval (option, value, _T("cd_block_cache"), &p->cd_block_cache, 1)
 		|| cfgfile_intval (option, value, _T("floppy_write_length"), &p->floppy_write_length, 1)
 		|| cfgfile_intval (option, value, _T("floppy_random_bits_min"), &p->floppy_random_bits_min, 1)
 		|| cfgfile_intval (option, value, _T("floppy_random_bits_max"), &p->floppy_random_bits_max, 1)
@@ -5719,6 +5727,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->cpu_compatible = 1;
 	p->address_space_24 = 1;
 	p->cpu_cycle_exact = 0;
+	p->cpu_cycle_exact_adaptive = 0;
 	p->blitter_cycle_exact = 0;
 	p->chipset_mask = CSMASK_ECS_AGNUS;
 	p->genlock = 0;
@@ -5758,6 +5767,14 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->dfxclickvolume = 33;
 	p->dfxclickchannelmask = 0xffff;
 	p->cd_speed = 100;
+	p->cd_block_cache = 1024;
+#ifdef CPU_64_BIT
+	p->cd_audio_predecode = true;
+#else
+	// decoded audio of a whole disc can exhaust a 32-bit address space
+	p->cd_audio_predecode = false;
+#endif
+	p->cd_audio_cache = false;
 
 	p->statecapturebuffersize = 100;
 	p->statecapturerate = 5 * 50;
@@ -5865,6 +5882,7 @@ static void buildin_default_prefs (struct uae_prefs *p)
 	p->cpu_compatible = 1;
 	p->address_space_24 = 1;
 	p->cpu_cycle_exact = 0;
+	p->cpu_cycle_exact_adaptive = 0;
 	p->blitter_cycle_exact = 0;
 	p->chipset_mask = CSMASK_ECS_AGNUS;
 	p->immediate_blits = 0;
@@ -243,6 +243,28 @@ static void compute_passed_time (void)
 	}
 }
 
+/* Same as compute_passed_time() but only for the timer that is read. */
+
+static unsigned long cia_timer_count (unsigned long t, unsigned int cr, unsigned int crmask, unsigned int start)
+{
+	unsigned long int ciaclocks;
+
+	if ((cr & crmask) != 0x01)
+		return t;
+	ciaclocks = (get_cycles () - eventtab[ev_cia].oldcycles + div10) / DIV10;
+	if (ciaclocks <= start)
+		return t;
+	return t - (ciaclocks - start);
+}
+
+/* Timer state only needs to be brought up to date when an underflow
+is due in this cycle, earlier ones were already handled by CIA_handler.  */
+
+STATIC_INLINE bool cia_update_due (void)
+{
+	return eventtab[ev_cia].active && eventtab[ev_cia].evtime == get_cycles ();
+}
+
 /* Called to advance all CIA timers to the current time.  This expects that
 one of the timer values will be modified, and CIA_calctimers will be called
 in the same cycle.  */
@@ -951,8 +973,6 @@ static uae_u8 ReadCIAA (unsigned int addr)
 	unsigned int tmp;
 	int reg = addr & 15;
 
-	compute_passed_time ();
-
 #if CIAA_DEBUG_R > 0
 	if (CIAA_DEBUG_R > 1 || (munge24 (M68K_GETPC) & 0xFFF80000) != 0xF80000)
 		write_log (_T("R_CIAA: bfe%x01 %08X\n"), reg, M68K_GETPC);
@@ -1035,13 +1055,13 @@ static uae_u8 ReadCIAA (unsigned int addr)
 #endif
 		return ciaadrb;
 	case 4:
-		return (uae_u8)((ciaata - ciaata_passed) & 0xff);
+		return (uae_u8)(cia_timer_count (ciaata, ciaacra, 0x21, ciaastarta) & 0xff);
 	case 5:
-		return (uae_u8)((ciaata - ciaata_passed) >> 8);
+		return (uae_u8)(cia_timer_count (ciaata, ciaacra, 0x21, ciaastarta) >> 8);
 	case 6:
-		return (uae_u8)((ciaatb - ciaatb_passed) & 0xff);
+		return (uae_u8)(cia_timer_count (ciaatb, ciaacrb, 0x61, ciaastartb) & 0xff);
 	case 7:
-		return (uae_u8)((ciaatb - ciaatb_passed) >> 8);
+		return (uae_u8)(cia_timer_count (ciaatb, ciaacrb, 0x61, ciaastartb) >> 8);
 	case 8:
 		if (ciaatlatch) {
 			ciaatlatch = 0;
@@ -1090,8 +1110,6 @@ static uae_u8 ReadCIAB (unsigned int addr)
 	}
 #endif
 
-	compute_passed_time ();
-
 	switch (reg) {
 	case 0:
 		tmp = 0;
@@ -1153,13 +1171,13 @@ static uae_u8 ReadCIAB (unsigned int addr)
 	case 3:
 		return ciabdrb;
 	case 4:
-		return (uae_u8)((ciabta - ciabta_passed) & 0xff);
+		return (uae_u8)(cia_timer_count (ciabta, ciabcra, 0x21, ciabstarta) & 0xff);
 	case 5:
-		return (uae_u8)((ciabta - ciabta_passed) >> 8);
+		return (uae_u8)(cia_timer_count (ciabta, ciabcra, 0x21, ciabstarta) >> 8);
 	case 6:
-		return (uae_u8)((ciabtb - ciabtb_passed) & 0xff);
+		return (uae_u8)(cia_timer_count (ciabtb, ciabcrb, 0x61, ciabstartb) & 0xff);
 	case 7:
-		return (uae_u8)((ciabtb - ciabtb_passed) >> 8);
+		return (uae_u8)(cia_timer_count (ciabtb, ciabcrb, 0x61, ciabstartb) >> 8);
 	case 8:
 		CIAB_tod_check ();
 		if (ciabtlatch) {
@@ -1273,9 +1291,13 @@ static void WriteCIAA (uae_u16 addr, uae_u8 val)
 #endif
 		break;
 	case 4:
-		CIA_update ();
-		ciaala = (ciaala & 0xff00) | val;
-		CIA_calctimers ();
+		if (cia_update_due ()) {
+			CIA_update ();
+			ciaala = (ciaala & 0xff00) | val;
+			CIA_calctimers ();
+		} else {
+			ciaala = (ciaala & 0xff00) | val;
+		}
 		break;
 	case 5:
 		CIA_update ();
@@ -1290,9 +1312,13 @@ static void WriteCIAA (uae_u16 addr, uae_u8 val)
 		CIA_calctimers ();
 		break;
 	case 6:
-		CIA_update ();
-		ciaalb = (ciaalb & 0xff00) | val;
-		CIA_calctimers ();
+		if (cia_update_due ()) {
+			CIA_update ();
+			ciaalb = (ciaalb & 0xff00) | val;
+			CIA_calctimers ();
+		} else {
+			ciaalb = (ciaalb & 0xff00) | val;
+		}
 		break;
 	case 7:
 		CIA_update ();
@@ -1440,9 +1466,13 @@ static void WriteCIAB (uae_u16 addr, uae_u8 val)
 		ciabdrb = val;
 		break;
 	case 4:
-		CIA_update ();
-		ciabla = (ciabla & 0xff00) | val;
-		CIA_calctimers ();
+		if (cia_update_due ()) {
+			CIA_update ();
+			ciabla = (ciabla & 0xff00) | val;
+			CIA_calctimers ();
+		} else {
+			ciabla = (ciabla & 0xff00) | val;
+		}
 		break;
 	case 5:
 		CIA_update ();
@@ -1457,9 +1487,13 @@ static void WriteCIAB (uae_u16 addr, uae_u8 val)
 		CIA_calctimers ();
 		break;
 	case 6:
-		CIA_update ();
-		ciablb = (ciablb & 0xff00) | val;
-		CIA_calctimers ();
+		if (cia_update_due ()) {
+			CIA_update ();
+			ciablb = (ciablb & 0xff00) | val;
+			CIA_calctimers ();
+		} else {
+			ciablb = (ciablb & 0xff00) | val;
+		}
 		break;
 	case 7:
 		CIA_update ();
@@ -2431,4 +2465,246 @@ uae_u8 *restore_keyboard (uae_u8 *src)
 	return src;
 }
 
+/* Lazy timer self test. Random timer setups are restored as CIA chunks
+ * and run from underflow to underflow twice: once with the full update
+ * on a latch low write and compute_passed_time() timer reads, once with
+ * the write shortcut and cia_timer_count(). Timer reads, ICR contents
+ * and underflow cycles must match.
+ */
+#define CIATEST_CHUNK 64
+#define CIATEST_STEPS 8
+#define CIATEST_MAXERRORS 10
+
+static unsigned long *const ciatest_t[4] = { &ciaata, &ciaatb, &ciabta, &ciabtb };
+static unsigned long *const ciatest_l[4] = { &ciaala, &ciaalb, &ciabla, &ciablb };
+static unsigned long *const ciatest_p[4] = { &ciaata_passed, &ciaatb_passed, &ciabta_passed, &ciabtb_passed };
+static unsigned int *const ciatest_cr[4] = { &ciaacra, &ciaacrb, &ciabcra, &ciabcrb };
+static unsigned int *const ciatest_st[4] = { &ciaastarta, &ciaastartb, &ciabstarta, &ciabstartb };
+
+struct ciatest_regs
+{
+	unsigned long t[4], l[4], p[4];
+	unsigned int cr[4], st[4];
+	unsigned int icr[2], imask[2], sdr_cnt[2];
+	int div10;
+	struct ev ev;
+};
+
+struct ciatest_result
+{
+	unsigned long reads[CIATEST_STEPS][4];
+	evt when[CIATEST_STEPS];
+	unsigned int icr[CIATEST_STEPS][2];
+	int steps;
+};
+
+static void ciatest_get (struct ciatest_regs *r)
+{
+	for (int i = 0; i < 4; i++) {
+		r->t[i] = *ciatest_t[i];
+		r->l[i] = *ciatest_l[i];
+		r->p[i] = *ciatest_p[i];
+		r->cr[i] = *ciatest_cr[i];
+		r->st[i] = *ciatest_st[i];
+	}
+	r->icr[0] = ciaaicr;
+	r->icr[1] = ciabicr;
+	r->imask[0] = ciaaimask;
+	r->imask[1] = ciabimask;
+	r->sdr_cnt[0] = ciaasdr_cnt;
+	r->sdr_cnt[1] = ciabsdr_cnt;
+	r->div10 = div10;
+	r->ev = eventtab[ev_cia];
+}
+
+static void ciatest_set (const struct ciatest_regs *r)
+{
+	for (int i = 0; i < 4; i++) {
+		*ciatest_t[i] = r->t[i];
+		*ciatest_l[i] = r->l[i];
+		*ciatest_p[i] = r->p[i];
+		*ciatest_cr[i] = r->cr[i];
+		*ciatest_st[i] = r->st[i];
+	}
+	ciaaicr = r->icr[0];
+	ciabicr = r->icr[1];
+	ciaaimask = r->imask[0];
+	ciabimask = r->imask[1];
+	ciaasdr_cnt = r->sdr_cnt[0];
+	ciabsdr_cnt = r->sdr_cnt[1];
+	div10 = r->div10;
+	eventtab[ev_cia] = r->ev;
+}
+
+// get_cycles () does not move inside the debugger, move the CIA time base back instead
+static void ciatest_advance (evt c)
+{
+	eventtab[ev_cia].oldcycles -= c;
+	eventtab[ev_cia].evtime -= c;
+}
+
+static void ciatest_run (const struct ciatest_regs *init, bool shortcut, int reg, uae_u8 val, const evt *gaps, struct ciatest_result *r)
+{
+	memset (r, 0, sizeof *r);
+	ciatest_set (init);
+	if (shortcut) {
+		if (reg & 0x10)
+			WriteCIAB (reg & 15, val);
+		else
+			WriteCIAA (reg & 15, val);
+	} else {
+		unsigned long *l = ciatest_l[((reg & 0x10) ? 2 : 0) + ((reg & 15) == 6 ? 1 : 0)];
+		CIA_update ();
+		*l = (*l & 0xff00) | val;
+		CIA_calctimers ();
+	}
+	for (r->steps = 0; r->steps < CIATEST_STEPS && eventtab[ev_cia].active; r->steps++) {
+		evt delta = eventtab[ev_cia].evtime - get_cycles ();
+		evt part = gaps[r->steps] % (delta + 1);
+		ciatest_advance (part);
+		if (shortcut) {
+			r->reads[r->steps][0] = cia_timer_count (ciaata, ciaacra, 0x21, ciaastarta) & 0xffff;
+			r->reads[r->steps][1] = cia_timer_count (ciaatb, ciaacrb, 0x61, ciaastartb) & 0xffff;
+			r->reads[r->steps][2] = cia_timer_count (ciabta, ciabcra, 0x21, ciabstarta) & 0xffff;
+			r->reads[r->steps][3] = cia_timer_count (ciabtb, ciabcrb, 0x61, ciabstartb) & 0xffff;
+		} else {
+			compute_passed_time ();
+			for (int i = 0; i < 4; i++)
+				r->reads[r->steps][i] = (*ciatest_t[i] - *ciatest_p[i]) & 0xffff;
+		}
+		ciatest_advance (delta - part);
+		CIA_handler ();
+		r->when[r->steps] = (r->steps ? r->when[r->steps - 1] : 0) + delta;
+		r->icr[r->steps][0] = ciaaicr;
+		r->icr[r->steps][1] = ciabicr;
+	}
+}
+
+static unsigned int ciatest_cr_random (bool crb)
+{
+	unsigned int v = 0;
+	if (uaerand () & 3)
+		v |= 0x01;
+	if ((uaerand () & 3) == 0)
+		v |= 0x08;
+	if (crb) {
+		// mostly counting 02 clocks, sometimes timer A underflows or CNT
+		if ((uaerand () & 3) == 0)
+			v |= (uaerand () & 3) << 5;
+	} else {
+		if ((uaerand () & 7) == 0)
+			v |= 0x20;
+		if (uaerand () & 1)
+			v |= 0x40;
+	}
+	return v;
+}
+
+static unsigned long ciatest_timer_random (void)
+{
+	// short timers so that several underflows are seen
+	return uaerand () & ((uaerand () & 3) ? 0xff : 0xffff);
+}
+
+static void ciatest_chunk (uae_u8 *chunk, int num)
+{
+	uae_u8 *dst;
+
+	dst = chunk + 4;
+	save_u16 (ciatest_timer_random ());			/* 4 TA */
+	save_u16 (ciatest_timer_random ());			/* 6 TB */
+	dst = chunk + 13;
+	save_u8 (0);								/* D ICR */
+	save_u8 (ciatest_cr_random (false));		/* E CRA */
+	save_u8 (ciatest_cr_random (true));			/* F CRB */
+	save_u8 (0);								/* ICR MASK, no interrupts */
+	unsigned long la = ciatest_timer_random ();
+	unsigned long lb = ciatest_timer_random ();
+	save_u8 (la);
+	save_u8 (la >> 8);
+	save_u8 (lb);
+	save_u8 (lb >> 8);
+	dst = chunk + 28;
+	if (num)
+		save_u8 (uaerand () % (DIV10 / CYCLE_UNIT));
+	else
+		save_u8 (0);
+	save_u8 (uaerand () % 9);					/* SDR count */
+}
+
+void cia_selftest (int loops, uae_u32 seed)
+{
+	uae_u8 live[2][CIATEST_CHUNK], chunk[2][CIATEST_CHUNK];
+	struct ciatest_regs liveregs, init;
+	struct ciatest_result res[2];
+	uae_u32 saverand = uaerandgetseed ();
+	int tested = 0, underflows = 0, errors = 0, len;
+
+	if (loops <= 0)
+		loops = 10000;
+	save_cia (0, &len, live[0]);
+	save_cia (1, &len, live[1]);
+	ciatest_get (&liveregs);
+
+	console_out_f (_T("CIA timer self test, seed %08X, %d setups\n"), seed, loops);
+	uaesrand (seed);
+	for (int l = 0; l < loops; l++) {
+		evt gaps[CIATEST_STEPS];
+		int reg;
+		uae_u8 val;
+
+		memcpy (chunk, live, sizeof chunk);
+		ciatest_chunk (chunk[0], 0);
+		ciatest_chunk (chunk[1], 1);
+		restore_cia (0, chunk[0]);
+		restore_cia (1, chunk[1]);
+		for (int i = 0; i < 4; i++)
+			*ciatest_st[i] = uaerand () % 3;
+		eventtab[ev_cia].oldcycles = get_cycles ();
+		CIA_calctimers ();
+		// somewhere before the next underflow, sometimes exactly on it
+		if (eventtab[ev_cia].active) {
+			evt dist = eventtab[ev_cia].evtime - get_cycles ();
+			ciatest_advance ((uaerand () & 3) ? uaerand () % (dist + 1) : dist);
+		}
+		ciatest_get (&init);
+		reg = ((uaerand () & 1) ? 0x10 : 0) | ((uaerand () & 1) ? 6 : 4);
+		val = uaerand ();
+		for (int i = 0; i < CIATEST_STEPS; i++)
+			gaps[i] = uaerand ();
+
+		ciatest_run (&init, false, reg, val, gaps, &res[0]);
+		ciatest_run (&init, true, reg, val, gaps, &res[1]);
+		tested++;
+		underflows += res[0].steps;
+
+		if (memcmp (&res[0], &res[1], sizeof res[0])) {
+			errors++;
+			if (errors <= CIATEST_MAXERRORS) {
+				console_out_f (_T("Mismatch %d: CIA%c latch %s=%02X CRA=%02X/%02X CRB=%02X/%02X steps %d/%d\n"),
+					errors, (reg & 0x10) ? 'B' : 'A', (reg & 15) == 4 ? _T("TA") : _T("TB"), val,
+					init.cr[0], init.cr[2], init.cr[1], init.cr[3], res[0].steps, res[1].steps);
+				for (int i = 0; i < res[0].steps && i < res[1].steps; i++) {
+					if (memcmp (res[0].reads[i], res[1].reads[i], sizeof res[0].reads[i]) ||
+						res[0].when[i] != res[1].when[i] || res[0].icr[i][0] != res[1].icr[i][0] || res[0].icr[i][1] != res[1].icr[i][1]) {
+						console_out_f (_T(" Step %d: cycle %lu %lu ICR %02X%02X %02X%02X timers %04lX %04lX %04lX %04lX / %04lX %04lX %04lX %04lX\n"),
+							i, res[0].when[i], res[1].when[i], res[0].icr[i][0], res[0].icr[i][1], res[1].icr[i][0], res[1].icr[i][1],
+							res[0].reads[i][0], res[0].reads[i][1], res[0].reads[i][2], res[0].reads[i][3],
+							res[1].reads[i][0], res[1].reads[i][1], res[1].reads[i][2], res[1].reads[i][3]);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	restore_cia (0, live[0]);
+	restore_cia (1, live[1]);
+	ciatest_set (&liveregs);
+	events_schedule ();
+	uaesrand (saverand);
+
+	console_out_f (_T("%d setups tested, %d underflows, %d mismatches.\n"), tested, underflows, errors);
+}
+
 #endif /* SAVESTATE */
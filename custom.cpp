@@ -45,6 +45,7 @@
 #include "luascript.h"
 #include "devices.h"
 #include "rommgr.h"
+#include "identify.h"
 
 #define CUSTOM_DEBUG 0
 #define SPRITE_DEBUG 0
@@ -114,7 +115,6 @@ static int extra_cycle;
 
 static int rpt_did_reset;
 struct ev eventtab[ev_max];
-struct ev2 eventtab2[ev2_max];
 
 int hpos_offset;
 int vpos;
@@ -341,6 +341,15 @@ struct copper {
 static struct copper cop_state;
 static int copper_enabled_thisline;
 static int cop_min_waittime;
+static int cop_skipped, cop_skipped_last, cop_skipped_max;
+static unsigned long cop_skipped_total, cop_skipped_frames;
+
+/* Custom register write statistics, [0] = CPU, [1] = copper */
+static bool wstats_enabled;
+static TCHAR *wstats_file;
+static uae_u32 wstats_count[2][256];
+static uae_u64 wstats_time[256];
+static uae_u32 wstats_frames;
 
 /*
 * Statistics
@@ -1767,6 +1776,8 @@ static void beginning_of_plane_block (int hpos, int fm)
 
 #if SPEEDUP
 
+static int long_fetch_copy_off;
+
 /* The usual inlining tricks - don't touch unless you know what you are doing. */
 STATIC_INLINE void long_fetch_16 (int plane, int nwords, int weird_number_of_bits, int dma)
 {
@@ -1787,6 +1798,24 @@ STATIC_INLINE void long_fetch_16 (int plane, int nwords, int weird_number_of_bit
 		/* @@@ Don't do this, fall back on chipmem_wget instead.  */
 		return;
 
+	/* No scroll delay and long aligned output: line data is the previously
+	 * fetched word followed by chip RAM as is, copy it a long at a time. */
+	if (!long_fetch_copy_off && delay == 0 && tmp_nbits == 0 && dma && !(nwords & 1)) {
+		int i;
+		outval = ((uae_u16)(todisplay2[plane] | fetchval) << 16) | do_get_mem_word (real_pt);
+		thisline_changed |= dataptr[0] ^ outval;
+		dataptr[0] = outval;
+		for (i = 1; i < nwords / 2; i++) {
+			outval = do_get_mem_long ((uae_u32 *)(real_pt + 2 * i - 1));
+			thisline_changed |= dataptr[i] ^ outval;
+			dataptr[i] = outval;
+		}
+		fetched[plane] = do_get_mem_word (real_pt + nwords - 1);
+		todisplay2[plane] = 0;
+		outword[plane] = outval;
+		return;
+	}
+
 	shiftbuffer = todisplay2[plane] << delay;
 
 	while (nwords > 0) {
@@ -1850,6 +1879,22 @@ STATIC_INLINE void long_fetch_32 (int plane, int nwords, int weird_number_of_bit
 		/* @@@ Don't do this, fall back on chipmem_wget instead.  */
 		return;
 
+	if (!long_fetch_copy_off && delay == 0 && tmp_nbits == 0 && dma && !(nwords & 1)) {
+		int i;
+		outval = (uae_u32)(todisplay2_aga[plane] | fetchval);
+		thisline_changed |= dataptr[0] ^ outval;
+		dataptr[0] = outval;
+		for (i = 1; i < nwords / 2; i++) {
+			outval = do_get_mem_long (real_pt + i - 1);
+			thisline_changed |= dataptr[i] ^ outval;
+			dataptr[i] = outval;
+		}
+		fetched_aga[plane] = do_get_mem_long (real_pt + nwords / 2 - 1);
+		todisplay2_aga[plane] = 0;
+		outword[plane] = outval;
+		return;
+	}
+
 	shiftbuffer = todisplay2_aga[plane] << delay;
 
 	while (nwords > 0) {
@@ -1946,6 +1991,27 @@ STATIC_INLINE void long_fetch_64 (int plane, int nwords, int weird_number_of_bit
 		/* @@@ Don't do this, fall back on chipmem_wget instead.  */
 		return;
 
+	if (!long_fetch_copy_off && delay == 0 && tmp_nbits == 0 && dma && !(nwords & 3)) {
+		int i;
+		fetchval |= todisplay2_aga[plane];
+		outval = (uae_u32)(fetchval >> 32);
+		thisline_changed |= dataptr[0] ^ outval;
+		dataptr[0] = outval;
+		outval = (uae_u32)fetchval;
+		thisline_changed |= dataptr[1] ^ outval;
+		dataptr[1] = outval;
+		for (i = 2; i < nwords / 2; i++) {
+			outval = do_get_mem_long (real_pt + i - 2);
+			thisline_changed |= dataptr[i] ^ outval;
+			dataptr[i] = outval;
+		}
+		fetched_aga[plane] = ((uae_u64)do_get_mem_long (real_pt + nwords / 2 - 2) << 32) | do_get_mem_long (real_pt + nwords / 2 - 1);
+		/* everything was shifted out (aga_shift_n() can't do zero shift) */
+		todisplay2_aga[plane] = 0;
+		outword[plane] = outval;
+		return;
+	}
+
 	shiftbuffer[1] = 0;
 	shiftbuffer[0] = todisplay2_aga[plane];
 	aga_shift (shiftbuffer, delay);
@@ -2064,6 +2130,194 @@ static void do_long_fetch (int hpos, int nwords, int dma, int fm)
 		fetch_state = fetch_was_plane0;
 }
 
+/* Long copy self test: the same random fetch is run with and without the
+ * long copy shortcut in long_fetch_16/32/64, line data and fetch state
+ * must match.
+ */
+#define FETCHTEST_BASE 0x10000
+#define FETCHTEST_SIZE 0x1000
+#define FETCHTEST_MAXERRORS 10
+
+struct fetchtest_state
+{
+	uae_u8 row[MAX_PLANES * MAX_WORDS_PER_LINE * 2];
+	uaecptr pt;
+	uae_u32 outword, changed;
+	uae_u16 fetched, todisplay2;
+	uae_u64 fetched_aga, todisplay2_aga;
+};
+
+static void fetchtest_get (int plane, struct fetchtest_state *s)
+{
+	memset (s, 0, sizeof *s);
+	memcpy (s->row, line_data[next_lineno], sizeof s->row);
+	s->pt = bplpt[plane];
+	s->outword = outword[plane];
+	s->changed = thisline_changed;
+	s->fetched = fetched[plane];
+	s->todisplay2 = todisplay2[plane];
+	s->fetched_aga = fetched_aga[plane];
+	s->todisplay2_aga = todisplay2_aga[plane];
+}
+
+static void fetchtest_set (int plane, const struct fetchtest_state *s)
+{
+	memcpy (line_data[next_lineno], s->row, sizeof s->row);
+	bplpt[plane] = bplptx[plane] = s->pt;
+	outword[plane] = s->outword;
+	thisline_changed = s->changed;
+	fetched[plane] = s->fetched;
+	todisplay2[plane] = s->todisplay2;
+	fetched_aga[plane] = s->fetched_aga;
+	todisplay2_aga[plane] = s->todisplay2_aga;
+}
+
+static void fetchtest_run (const struct fetchtest_state *init, int plane, int fm, int nwords, int dma, int copy, struct fetchtest_state *r)
+{
+	int weird = out_nbits & 15;
+
+	fetchtest_set (plane, init);
+	long_fetch_copy_off = !copy;
+	switch (fm) {
+	case 0:
+		if (weird)
+			long_fetch_16_1 (plane, nwords, dma);
+		else
+			long_fetch_16_0 (plane, nwords, dma);
+		break;
+#ifdef AGA
+	case 1:
+		if (weird)
+			long_fetch_32_1 (plane, nwords, dma);
+		else
+			long_fetch_32_0 (plane, nwords, dma);
+		break;
+	case 2:
+		if (weird)
+			long_fetch_64_1 (plane, nwords, dma);
+		else
+			long_fetch_64_0 (plane, nwords, dma);
+		break;
+#endif
+	}
+	long_fetch_copy_off = 0;
+	fetchtest_get (plane, r);
+	// generic FMODE=3 path leaves aga_shift_n (, 0) garbage here, it is undefined
+	if (fm == 2 && toscr_delay_adjusted[plane & 1] == 0)
+		r->todisplay2_aga = 0;
+}
+
+void custom_fetch_selftest (int loops, uae_u32 seed)
+{
+	uae_u8 *mem, *savemem;
+	struct fetchtest_state *live, *init, *res;
+	uaecptr saveptx[8];
+	int savedelay[2] = { toscr_delay_adjusted[0], toscr_delay_adjusted[1] };
+	int savenbits = out_nbits, saveoffs = out_offs;
+	uae_u32 saverand = uaerandgetseed ();
+	uae_u32 size;
+	int tested = 0, copies = 0, errors = 0;
+
+	mem = chipmem_dma_base (&size);
+	if (!mem || size < FETCHTEST_BASE + FETCHTEST_SIZE) {
+		console_out (_T("Bitplane fetch self test needs at least 128k of directly mapped chip RAM.\n"));
+		return;
+	}
+	if (loops <= 0)
+		loops = 10000;
+	savemem = xmalloc (uae_u8, FETCHTEST_SIZE);
+	live = xmalloc (struct fetchtest_state, MAX_PLANES);
+	init = xmalloc (struct fetchtest_state, 1);
+	res = xmalloc (struct fetchtest_state, 2);
+	memcpy (savemem, mem + FETCHTEST_BASE, FETCHTEST_SIZE);
+	memcpy (saveptx, bplptx, sizeof saveptx);
+	for (int i = 0; i < MAX_PLANES; i++)
+		fetchtest_get (i, &live[i]);
+
+	console_out_f (_T("Bitplane fetch long copy self test, seed %08X, %d fetches\n"), seed, loops);
+	uaesrand (seed);
+	for (int l = 0; l < loops; l++) {
+#ifdef AGA
+		int fm = uaerand () % 3;
+#else
+		int fm = 0;
+#endif
+		int unit = 1 << fm;
+		int plane = uaerand () % MAX_PLANES;
+		int nwords = unit * (1 + uaerand () % ((MAX_WORDS_PER_LINE - 10) / unit));
+		int dma = (uaerand () & 7) != 0;
+		int delay;
+
+		for (int i = 0; i < FETCHTEST_SIZE; i += 4)
+			do_put_mem_long ((uae_u32*)(mem + FETCHTEST_BASE + i), uaerand ());
+		memset (init, 0, sizeof *init);
+		for (int i = 0; i < sizeof init->row; i += 4)
+			do_put_mem_long ((uae_u32*)(init->row + i), uaerand ());
+		init->pt = FETCHTEST_BASE + (uaerand () & 0x7ff & ~((2 << fm) - 1));
+		init->outword = (uaerand () << 16) | uaerand ();
+		init->fetched = uaerand ();
+		init->fetched_aga = ((uae_u64)uaerand () << 48) | ((uae_u64)uaerand () << 32) | (uaerand () << 16) | uaerand ();
+		init->todisplay2 = (uaerand () & 3) ? 0 : uaerand ();
+		init->todisplay2_aga = (uaerand () & 3) ? 0 : ((uae_u64)uaerand () << 48) | ((uae_u64)uaerand () << 32) | (uaerand () << 16) | uaerand ();
+		if (fm < 2)
+			init->todisplay2_aga &= 0xffffffff;
+		// mostly no scroll and long aligned output, the long copy case
+		delay = (uaerand () & 3) ? 0 : uaerand () & ((16 << fm) - 1);
+		toscr_delay_adjusted[plane & 1] = delay;
+		out_nbits = (uaerand () & 3) ? 0 : (uaerand () & 1) ? 16 : uaerand () & 31;
+		out_offs = uaerand () % (MAX_WORDS_PER_LINE / 2 - nwords / 2 - 1);
+
+		fetchtest_run (init, plane, fm, nwords, dma, 0, &res[0]);
+		fetchtest_run (init, plane, fm, nwords, dma, 1, &res[1]);
+		tested++;
+		if (delay == 0 && out_nbits == 0 && dma && !(nwords & (fm == 2 ? 3 : 1)))
+			copies++;
+
+		if (memcmp (&res[0], &res[1], sizeof res[0])) {
+			errors++;
+			if (errors <= FETCHTEST_MAXERRORS) {
+				console_out_f (_T("Mismatch %d: FMODE %d plane %d words %d DMA %d delay %d nbits %d offs %d PT %08X\n"),
+					errors, fm, plane, nwords, dma, delay, out_nbits, out_offs, init->pt);
+				console_out_f (_T(" OUT %08X %08X CHANGED %08X %08X FETCHED %04X %04X TODISPLAY2 %04X %04X PT %08X %08X\n"),
+					res[0].outword, res[1].outword, res[0].changed, res[1].changed, res[0].fetched, res[1].fetched,
+					res[0].todisplay2, res[1].todisplay2, res[0].pt, res[1].pt);
+				console_out_f (_T(" FETCHED_AGA %08X%08X %08X%08X TODISPLAY2_AGA %08X%08X %08X%08X\n"),
+					(uae_u32)(res[0].fetched_aga >> 32), (uae_u32)res[0].fetched_aga, (uae_u32)(res[1].fetched_aga >> 32), (uae_u32)res[1].fetched_aga,
+					(uae_u32)(res[0].todisplay2_aga >> 32), (uae_u32)res[0].todisplay2_aga, (uae_u32)(res[1].todisplay2_aga >> 32), (uae_u32)res[1].todisplay2_aga);
+				for (int i = 0; i < sizeof res[0].row; i++) {
+					if (res[0].row[i] != res[1].row[i]) {
+						console_out_f (_T(" Line data %d: %02X %02X\n"), i, res[0].row[i], res[1].row[i]);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < MAX_PLANES; i++)
+		fetchtest_set (i, &live[i]);
+	memcpy (bplptx, saveptx, sizeof saveptx);
+	toscr_delay_adjusted[0] = savedelay[0];
+	toscr_delay_adjusted[1] = savedelay[1];
+	out_nbits = savenbits;
+	out_offs = saveoffs;
+	memcpy (mem + FETCHTEST_BASE, savemem, FETCHTEST_SIZE);
+	xfree (res);
+	xfree (init);
+	xfree (live);
+	xfree (savemem);
+	uaesrand (saverand);
+
+	console_out_f (_T("%d fetches tested (%d long copies), %d mismatches.\n"), tested, copies, errors);
+}
+
+#else
+
+void custom_fetch_selftest (int loops, uae_u32 seed)
+{
+	console_out (_T("Bitplane fetch self test needs SPEEDUP.\n"));
+}
+
 #endif
 
 static void finish_last_fetch (int pos, int fm, bool reallylast)
@@ -6281,8 +6535,26 @@ static void update_copper (int until_hpos)
 					continue;
 
 				hp = ch_comp & (cop_state.saved_i2 & 0xFE);
-				if (vp == cop_state.vcmp && hp < cop_state.hcmp)
+				if (vp == cop_state.vcmp && hp < cop_state.hcmp) {
+					/* Waiting copper does not use any cycles. With full horizontal
+					 * mask nothing can happen before hcmp, jump straight there.
+					 * (until_hpos is current time, nothing else can change the
+					 * wait state in between.)
+					 */
+					if ((cop_state.saved_i2 & 0xFE) == 0xFE && !cop_state.movedelay) {
+						int target = cop_state.hcmp - 2;
+						if (target > until_hpos)
+							target = until_hpos;
+						if (target > maxhpos - 3)
+							target = maxhpos - 3;
+						target &= ~1;
+						if (target > c_hpos) {
+							cop_skipped += (target - c_hpos) / 2;
+							c_hpos = target;
+						}
+					}
 					break;
+				}
 
 #ifdef DEBUGGER
 				if (debug_dma)
@@ -6401,6 +6673,19 @@ void blitter_done_notify (int hpos)
 	}
 }
 
+void copper_dump_stats (void)
+{
+	console_out_f (_T("Copper WAIT cycles skipped: %d (last frame) %d (max) %lu (avg over %lu frames)\n"),
+		cop_skipped_last, cop_skipped_max,
+		cop_skipped_frames ? cop_skipped_total / cop_skipped_frames : 0, cop_skipped_frames);
+}
+
+void copper_reset_stats (void)
+{
+	cop_skipped = cop_skipped_last = cop_skipped_max = 0;
+	cop_skipped_total = cop_skipped_frames = 0;
+}
+
 void do_copper (void)
 {
 	int hpos = current_hpos ();
@@ -7274,6 +7559,15 @@ static void vsync_handler_post (void)
 #endif
 	DISK_vsync ();
 
+	cop_skipped_last = cop_skipped;
+	if (cop_skipped > cop_skipped_max)
+		cop_skipped_max = cop_skipped;
+	cop_skipped_total += cop_skipped;
+	cop_skipped_frames++;
+	cop_skipped = 0;
+	if (wstats_enabled)
+		wstats_frames++;
+
 #ifdef WITH_LUA
 	uae_lua_run_handler ("on_uae_vsync");
 #endif
@@ -7942,6 +8236,8 @@ static void hsync_handler_post (bool onvsync)
 	/* See if there's a chance of a copper wait ending this line.  */
 	cop_state.hpos = 0;
 	compute_spcflag_copper (maxhpos);
+	if (cpu_ce_adaptive)
+		cpu_ce_adaptive_hsync (bltstate == BLT_done && !copper_enabled_thisline);
 
 	//copper_check (2);
 
@@ -8042,9 +8338,7 @@ void init_eventtab (void)
 		eventtab[i].active = 0;
 		eventtab[i].oldcycles = get_cycles ();
 	}
-	for (i = 0; i < ev2_max; i++) {
-		eventtab2[i].active = 0;
-	}
+	init_eventtab2 ();
 
 	eventtab[ev_cia].handler = CIA_handler;
 	eventtab[ev_hsync].handler = hsync_handler;
@@ -8551,7 +8845,7 @@ static uae_u32 REGPARAM2 custom_lget (uaecptr addr)
 		return dummy_get(addr, 4, false);
 	return ((uae_u32)custom_wget (addr) << 16) | custom_wget (addr + 2);
 }
-static int REGPARAM2 custom_wput_1 (int hpos, uaecptr addr, uae_u32 value, int noget)
+static int REGPARAM2 custom_wput_2 (int hpos, uaecptr addr, uae_u32 value, int noget)
 {
 	addr &= 0x1FE;
 	value &= 0xffff;
@@ -8763,6 +9057,121 @@ static int REGPARAM2 custom_wput_1 (int hpos, uaecptr addr, uae_u32 value, int n
 	return 0;
 }
 
+static int REGPARAM2 custom_wput_1 (int hpos, uaecptr addr, uae_u32 value, int noget)
+{
+	if (wstats_enabled) {
+		frame_time_t t = read_processor_time ();
+		int reg = (addr & 0x1fe) >> 1;
+		int v = custom_wput_2 (hpos, addr, value, noget);
+		wstats_time[reg] += read_processor_time () - t;
+		wstats_count[copper_access ? 1 : 0][reg]++;
+		return v;
+	}
+	return custom_wput_2 (hpos, addr, value, noget);
+}
+
+static const TCHAR *wstats_name (int reg)
+{
+	const TCHAR *name = NULL;
+	for (int i = 0; custd[i].name; i++) {
+		if ((custd[i].adr & 0x1fe) != reg * 2)
+			continue;
+		if (custd[i].rw != 1)
+			return custd[i].name;
+		if (!name)
+			name = custd[i].name;
+	}
+	return name ? name : _T("-");
+}
+
+void custom_wstats_enable (const TCHAR *csvfile)
+{
+	wstats_enabled = true;
+	if (csvfile) {
+		xfree (wstats_file);
+		wstats_file = my_strdup (csvfile);
+	}
+}
+
+void custom_wstats_reset (void)
+{
+	memset (wstats_count, 0, sizeof wstats_count);
+	memset (wstats_time, 0, sizeof wstats_time);
+	wstats_frames = 0;
+}
+
+void custom_wstats_dump (void)
+{
+	int order[256];
+	int i, j, cnt = 0;
+	uae_u64 total = 0;
+
+	if (!wstats_enabled) {
+		custom_wstats_enable (NULL);
+		console_out (_T("Custom register write statistics enabled.\n"));
+		return;
+	}
+	for (i = 0; i < 256; i++) {
+		uae_u32 c = wstats_count[0][i] + wstats_count[1][i];
+		if (!c)
+			continue;
+		for (j = cnt; j > 0; j--) {
+			int o = order[j - 1];
+			if (wstats_time[o] > wstats_time[i] || (wstats_time[o] == wstats_time[i] && wstats_count[0][o] + wstats_count[1][o] >= c))
+				break;
+			order[j] = order[j - 1];
+		}
+		order[j] = i;
+		cnt++;
+		total += wstats_time[i];
+	}
+	if (!cnt) {
+		console_out (_T("No custom register writes recorded.\n"));
+		return;
+	}
+	console_out_f (_T("Reg  Name            CPU     Copper   Per frame      Time    %%  (%u frames)\n"), wstats_frames);
+	for (i = 0; i < cnt && i < 40; i++) {
+		int r = order[i];
+		uae_u32 c = wstats_count[0][r] + wstats_count[1][r];
+		console_out_f (_T("%03X  %-10s %9u %9u %11.1f %7.2fms %3d\n"),
+			r * 2, wstats_name (r), wstats_count[0][r], wstats_count[1][r],
+			wstats_frames ? (double)c / wstats_frames : 0.0,
+			syncbase > 0 ? wstats_time[r] * 1000.0 / syncbase : 0.0,
+			total ? (int)(wstats_time[r] * 100 / total) : 0);
+	}
+}
+
+bool custom_wstats_save (const TCHAR *csvfile)
+{
+	FILE *f = _tfopen (csvfile, _T("w"));
+	if (!f)
+		return false;
+	_ftprintf (f, _T("reg,name,cpu,copper,total,per_frame,time_us,time_per_frame_us\n"));
+	for (int i = 0; i < 256; i++) {
+		uae_u32 c = wstats_count[0][i] + wstats_count[1][i];
+		double us = syncbase > 0 ? wstats_time[i] * 1000000.0 / syncbase : 0.0;
+		if (!c)
+			continue;
+		_ftprintf (f, _T("%03X,%s,%u,%u,%u,%.2f,%.1f,%.3f\n"),
+			i * 2, wstats_name (i), wstats_count[0][i], wstats_count[1][i], c,
+			wstats_frames ? (double)c / wstats_frames : 0.0,
+			us, wstats_frames ? us / wstats_frames : 0.0);
+	}
+	fclose (f);
+	return true;
+}
+
+void custom_wstats_free (void)
+{
+	if (wstats_file) {
+		if (!custom_wstats_save (wstats_file))
+			write_log (_T("Couldn't write custom register statistics to '%s'\n"), wstats_file);
+		xfree (wstats_file);
+		wstats_file = NULL;
+	}
+	wstats_enabled = false;
+}
+
 static void REGPARAM2 custom_wput (uaecptr addr, uae_u32 value)
 {
 	int hpos = current_hpos ();
@@ -8839,7 +9248,7 @@ void custom_prepare_savestate (void)
 
 	for (i = 0; i < ev2_max; i++) {
 		if (eventtab2[i].active) {
-			eventtab2[i].active = 0;
+			event2_remevent (i);
 			eventtab2[i].handler (eventtab2[i].data);
 		}
 	}
@@ -9358,9 +9767,14 @@ uae_u8 *save_custom_extra (int *len, uae_u8 *dstptr)
 
 uae_u8 *restore_custom_event_delay (uae_u8 *src)
 {
-	if (restore_u32 () != 1)
+	uae_u32 ver = restore_u32 ();
+	int cnt;
+	if (ver == 1)
+		cnt = restore_u8 ();
+	else if (ver == 2)
+		cnt = restore_u32 ();
+	else
 		return src;
-	int cnt = restore_u8 ();
 	for (int i = 0; i < cnt; i++) {
 		uae_u8 type = restore_u8 ();
 		evt e = restore_u64 ();
@@ -9387,17 +9801,22 @@ uae_u8 *save_custom_event_delay (int *len, uae_u8 *dstptr)
 	if (dstptr)
 		dstbak = dst = dstptr;
 	else
-		dstbak = dst = xmalloc (uae_u8, 1000);
+		dstbak = dst = xmalloc (uae_u8, 4 + 4 + cnt * (1 + 8 + 4));
 
-	save_u32 (1);
-	save_u8 (cnt);
+	// version 2 (32-bit count) only when the grown event2 table needs it
+	if (cnt > 255) {
+		save_u32 (2);
+		save_u32 (cnt);
+	} else {
+		save_u32 (1);
+		save_u8 (cnt);
+	}
 	for (int i = ev2_misc; i < ev2_max; i++) {
 		struct ev2 *e = &eventtab2[i];
 		if (e->active && e->handler == send_interrupt_do) {
 			save_u8 (1);
 			save_u64 (e->evtime - get_cycles ());
 			save_u32 (e->data);
-		
 		}
 	}
 
@@ -9515,6 +9934,8 @@ static int dma_cycle (void)
 	int hpos, hpos_old;
 
 	blitter_nasty = 1;
+	if (cpu_ce_adaptive)
+		cpu_ce_adaptive_access ();
 	if (cpu_tracer  < 0)
 		return current_hpos ();
 	if (!currprefs.cpu_cycle_exact)
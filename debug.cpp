@@ -23,13 +23,17 @@
 #include "debug.h"
 #include "cia.h"
 #include "xwin.h"
+#include "drawing.h"
 #include "identify.h"
 #include "audio.h"
 #include "sound.h"
 #include "disk.h"
+#include "diskutil.h"
+#include "blitter.h"
 #include "savestate.h"
 #include "autoconf.h"
 #include "akiko.h"
+#include "cd32_fmv.h"
 #include "inputdevice.h"
 #include "crc32.h"
 #include "cpummu.h"
@@ -99,6 +103,13 @@ static TCHAR help[] = {
 	_T("         -----------------------\n\n")
 	_T("  g [<address>]         Start execution at the current address or <address>.\n")
 	_T("  c                     Dump state of the CIA, disk drives and custom registers.\n")
+	_T("  ct [<count>] [<core1> <core2>] [<seed>]\n")
+	_T("                        Compare random instructions between two CPU cores\n")
+	_T("                        (0=generic,1=indirect,2=prefetch,3=cycle-exact). Uses chip RAM 0-128k.\n")
+	_T("  ci [<count>] [<seed>] Compare CIA timer shortcuts against full updates on random timer setups.\n")
+	_T("  cf [<count>] [<seed>] Compare bitplane fetch long copies against the word loop on random fetches.\n")
+	_T("  cs [<count>] [<seed>] Check sprite spans and split line drawing against the full sprite path.\n")
+	_T("  ch [<count>] [<seed>] Compare the table HAM decoder against the old per pixel decoder.\n")
 	_T("  r                     Dump state of the CPU.\n")
 	_T("  r <reg> <value>       Modify CPU registers (Dx,Ax,USP,ISP,VBR,...).\n")
 	_T("  m <address> [<lines>] Memory dump starting at <address>.\n")
@@ -123,6 +134,7 @@ static TCHAR help[] = {
 	_T("  od                    Enable/disable Copper vpos/hpos tracing.\n")
 	_T("  ot                    Copper single step trace.\n")
 	_T("  ob <addr>             Copper breakpoint.\n")
+	_T("  os [r]                Show Copper WAIT skip statistics, r = reset.\n")
 	_T("  H[H] <cnt>            Show PC history (HH=full CPU info) <cnt> instructions.\n")
 	_T("  C <value>             Search for values like energy or lifes in games.\n")
 	_T("  Cl                    List currently found trainer addresses.\n")
@@ -145,9 +157,22 @@ static TCHAR help[] = {
 	_T("  di <mode> [<track>]   Break on disk access. R=DMA read,W=write,RW=both,P=PIO.\n")
 	_T("                        Also enables level 1 disk logging.\n")
 	_T("  did <log level>       Enable disk logging.\n")
+	_T("  dib [<loops>]         MFM encode/decode benchmark of a full 80 cylinder disk.\n")
+#ifdef CD32
+	_T("  dv [<loops>]          CD32 FMV YUV conversion and genlock benchmark.\n")
+	_T("  dk [<count>] [<seed>] Compare Akiko C2P against the bit loop, long against byte access.\n")
+#endif
 	_T("  dj [<level bitmask>]  Enable joystick/mouse input debugging.\n")
 	_T("  smc [<0-1>]           Enable self-modifying code detector. 1 = enable break.\n")
 	_T("  dm                    Dump current address space map.\n")
+#ifdef JIT
+	_T("  J [r]                 Show JIT block/exit site statistics, r = reset (totals kept).\n")
+#endif
+	_T("  B [r]                 Show blitter minterm usage and time, r = reset and time.\n")
+	_T("  Bt [<loops>] [<seed>] Blitter row path vs word loop self test, all minterms.\n")
+	_T("  E [r]                 Show pending events and dispatch counts, r = reset.\n")
+	_T("  R [r|s <file>]        Show custom register write counts and time (first use enables),\n")
+	_T("                        r = reset, s = save as CSV.\n")
 	_T("  v <vpos> [<hpos>]     Show DMA data (accurate only in cycle-exact mode).\n")
 	_T("                        v [-1 to -4] = enable visual DMA debugger.\n")
 	_T("  ?<value>              Hex ($ and 0x)/Bin (%)/Dec (!) converter.\n")
@@ -1432,6 +1457,15 @@ static int copper_debugger (TCHAR **c)
 	} else if (**c == 't') {
 		debug_copper = 1|2;
 		return 1;
+	} else if (**c == 's') {
+		next_char (c);
+		ignore_ws (c);
+		if (**c == 'r') {
+			copper_reset_stats ();
+			console_out (_T("Copper statistics cleared.\n"));
+		} else {
+			copper_dump_stats ();
+		}
 	} else if (**c == 'b') {
 		(*c)++;
 		debug_copper = 1|4;
@@ -4093,6 +4127,15 @@ static void disk_debug (TCHAR **inptr)
 		console_out_f (_T("Disk logging level %d\n"), disk_debug_logging);
 		return;
 	}
+	if (**inptr == 'b') {
+		int loops = 0;
+		(*inptr)++;
+		ignore_ws (inptr);
+		if (more_params (inptr))
+			loops = readint (inptr);
+		mfm_benchmark (loops);
+		return;
+	}
 	disk_debug_mode = 0;
 	disk_debug_track = -1;
 	ignore_ws (inptr);
@@ -4237,7 +4280,63 @@ static BOOL debug_line (TCHAR *input)
 
 	switch (cmd)
 	{
-		case 'c': dumpcia (); dumpdisk (); dumpcustom (); break;
+		case 'c':
+			if (*inptr == 't') {
+				int count = 1000, core1 = 0, core2 = currprefs.cpu_cycle_exact ? 3 : (currprefs.cpu_compatible ? 2 : 0);
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					count = readint (&inptr);
+				if (more_params (&inptr)) {
+					core1 = readint (&inptr);
+					if (more_params (&inptr))
+						core2 = readint (&inptr);
+				}
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				cpu_selftest (count, core1, core2, seed);
+#ifdef SAVESTATE
+			} else if (*inptr == 'i') {
+				int count = 10000;
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					count = readint (&inptr);
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				cia_selftest (count, seed);
+#endif
+			} else if (*inptr == 'f') {
+				int count = 10000;
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					count = readint (&inptr);
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				custom_fetch_selftest (count, seed);
+			} else if (*inptr == 's') {
+				int count = 10000;
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					count = readint (&inptr);
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				drawing_sprite_span_selftest (count, seed);
+			} else if (*inptr == 'h') {
+				int count = 1000;
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					count = readint (&inptr);
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				drawing_ham_selftest (count, seed);
+			} else {
+				dumpcia (); dumpdisk (); dumpcustom ();
+			}
+			break;
 		case 'i':
 		{
 			if (*inptr == 'l') {
@@ -4269,6 +4368,58 @@ static BOOL debug_line (TCHAR *input)
 					m68k_dumpstate (&nextpc);
 			}
 			break;
+#ifdef JIT
+		case 'J':
+			if (*inptr == 'r') {
+				compemu_reset_stats ();
+				console_out (_T("JIT statistics cleared.\n"));
+			} else {
+				compemu_dump_stats ();
+			}
+			break;
+#endif
+		case 'B':
+			if (*inptr == 'r') {
+				blitter_reset_stats ();
+				console_out (_T("Blitter statistics cleared.\n"));
+			} else if (*inptr == 't') {
+				int loops = 0;
+				uae_u32 seed = uaerandgetseed ();
+				next_char (&inptr);
+				if (more_params (&inptr))
+					loops = readint (&inptr);
+				if (more_params (&inptr))
+					seed = readhex (&inptr);
+				blitter_selftest (loops, seed);
+			} else {
+				blitter_dump_stats ();
+			}
+			break;
+		case 'E':
+			if (*inptr == 'r') {
+				events_reset_stats ();
+				console_out (_T("Event statistics cleared.\n"));
+			} else {
+				events_dump ();
+			}
+			break;
+		case 'R':
+			if (*inptr == 'r') {
+				custom_wstats_reset ();
+				console_out (_T("Custom register write statistics cleared.\n"));
+			} else if (*inptr == 's') {
+				next_char (&inptr);
+				ignore_ws (&inptr);
+				if (!*inptr)
+					break;
+				if (custom_wstats_save (inptr))
+					console_out_f (_T("Custom register write statistics saved to '%s'.\n"), inptr);
+				else
+					console_out_f (_T("Couldn't open file '%s'\n"), inptr);
+			} else {
+				custom_wstats_dump ();
+			}
+			break;
 		case 'D': deepcheatsearch (&inptr); break;
 		case 'C': cheatsearch (&inptr); break;
 		case 'W': writeintomem (&inptr); break;
@@ -4309,6 +4460,23 @@ static BOOL debug_line (TCHAR *input)
 				} else if (*inptr == 't') {
 					next_char (&inptr);
 					debugtest_set (&inptr);
+#ifdef CD32
+				} else if (*inptr == 'v') {
+					int loops = 0;
+					next_char (&inptr);
+					if (more_params (&inptr))
+						loops = readint (&inptr);
+					cd32_fmv_benchmark (loops);
+				} else if (*inptr == 'k') {
+					int loops = 0;
+					uae_u32 seed = uaerandgetseed ();
+					next_char (&inptr);
+					if (more_params (&inptr))
+						loops = readint (&inptr);
+					if (more_params (&inptr))
+						seed = readhex (&inptr);
+					akiko_c2p_selftest (loops, seed);
+#endif
 #ifdef _WIN32
 				} else if (*inptr == 'g') {
 					extern void update_disassembly (uae_u32);
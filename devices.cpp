@@ -57,8 +57,192 @@
 #include "rp.h"
 #endif
 
+#define MAX_DEVICE_ITEMS 32
+typedef void (*DEVICE_VOID)(void);
+typedef bool (*DEVICE_IRQ)(void);
+
+/* Per-line and interrupt rethink handlers of devices that actually
+ * exist in the current configuration, rebuilt at every reset.
+ *
+ * Handlers registered with a device id sleep: the hsync handler only
+ * runs for DEVICE_WAKE_LINES lines after devices_hsync_wake(), and the
+ * rethink handler, which returns its interrupt line state, only runs
+ * when the device is awake, marked dirty with devices_irq_dirty(), or
+ * its line was still active at the previous rethink.
+ */
+struct device_item
+{
+	DEVICE_VOID func;
+	DEVICE_IRQ irq;
+	int id;
+};
+static struct device_item device_hsyncs[MAX_DEVICE_ITEMS];
+static int device_hsync_cnt;
+static struct device_item device_rethinks[MAX_DEVICE_ITEMS];
+static int device_rethink_cnt;
+
+#define DEVICE_WAKE_LINES 4
+// wake requests may come from device threads, only the hsync side
+// compares the counters and updates the line countdown.
+static volatile int device_wake_req[DEVICE_ID_MAX];
+static int device_wake_seen[DEVICE_ID_MAX];
+static int device_wake_lines[DEVICE_ID_MAX];
+static uae_u32 device_irq_dirty_mask, device_irq_active;
+
+static void device_add_item(struct device_item *pp, int *cnt, DEVICE_VOID p, DEVICE_IRQ irq, int id)
+{
+	for (int i = 0; i < *cnt; i++) {
+		if (pp[i].func == p && pp[i].irq == irq)
+			return;
+	}
+	if (*cnt >= MAX_DEVICE_ITEMS) {
+		write_log(_T("device handler table full\n"));
+		return;
+	}
+	pp[*cnt].func = p;
+	pp[*cnt].irq = irq;
+	pp[*cnt].id = id;
+	(*cnt)++;
+}
+
+static void device_add_hsync(DEVICE_VOID p)
+{
+	device_add_item(device_hsyncs, &device_hsync_cnt, p, NULL, DEVICE_ID_NONE);
+}
+
+static void device_add_hsync_id(DEVICE_VOID p, int id)
+{
+	device_add_item(device_hsyncs, &device_hsync_cnt, p, NULL, id);
+}
+
+static void device_add_rethink(DEVICE_VOID p)
+{
+	device_add_item(device_rethinks, &device_rethink_cnt, p, NULL, DEVICE_ID_NONE);
+}
+
+static void device_add_rethink_irq(DEVICE_IRQ p, int id)
+{
+	device_add_item(device_rethinks, &device_rethink_cnt, NULL, p, id);
+}
+
+void devices_hsync_wake(int id)
+{
+	device_wake_req[id]++;
+}
+
+void devices_irq_dirty(int id)
+{
+	device_irq_dirty_mask |= 1 << id;
+}
+
+#ifdef AHI
+void ahi_hsync(void);
+#endif
+
+static void devices_decide_blitter(void)
+{
+	decide_blitter(-1);
+}
+
+// same conditions expansion.cpp uses to add the boards, order is kept
+static void devices_build_handlers(void)
+{
+	device_hsync_cnt = 0;
+	device_rethink_cnt = 0;
+	// everything starts awake and dirty, restored state may have pending work
+	for (int i = 0; i < DEVICE_ID_MAX; i++) {
+		device_wake_seen[i] = device_wake_req[i];
+		device_wake_lines[i] = DEVICE_WAKE_LINES;
+	}
+	device_irq_dirty_mask = (1 << DEVICE_ID_MAX) - 1;
+	device_irq_active = 0;
+
+#ifdef A2065
+	if (currprefs.a2065name[0])
+		device_add_hsync(a2065_hsync_handler);
+#endif
+#ifdef CD32
+	if (currprefs.cs_cd32cd)
+		device_add_hsync(AKIKO_hsync_handler);
+	if (currprefs.cs_cd32fmv)
+		device_add_hsync(cd32_fmv_hsync_handler);
+#endif
+#ifdef CDTV
+	if (currprefs.cs_cdtvcd && !currprefs.cs_cdtvcr)
+		device_add_hsync(CDTV_hsync_handler);
+	if (currprefs.cs_cdtvcr)
+		device_add_hsync(CDTVCR_hsync_handler);
+#endif
+	device_add_hsync(devices_decide_blitter);
+#ifdef PICASSO96
+	device_add_hsync(picasso_handle_hsync);
+#endif
+#ifdef AHI
+	device_add_hsync(ahi_hsync);
+#endif
+#ifdef WITH_PPC
+	if (currprefs.ppc_mode || currprefs.cpuboard_type) {
+		device_add_hsync(uae_ppc_hsync_handler);
+		device_add_hsync(cpuboard_hsync);
+	}
+#endif
+#ifdef WITH_TOCCATA
+	if (currprefs.sound_toccata)
+		device_add_hsync(sndboard_hsync);
+#endif
+	device_add_hsync(DISK_hsync);
+	device_add_hsync(audio_hsync);
+	device_add_hsync(CIA_hsync_prehandler);
+	device_add_hsync(serial_hsynchandler);
+	// IDE hsync only counts down interrupt delays set by ide_interrupt()
+	if (currprefs.cs_ide || currprefs.cs_pcmcia)
+		device_add_hsync_id(gayle_hsync, DEVICE_ID_IDE);
+	device_add_hsync_id(idecontroller_hsync, DEVICE_ID_IDE);
+#ifdef A2091
+	device_add_hsync(scsi_hsync);
+#endif
+
+	device_add_rethink(rethink_cias);
+#ifdef A2065
+	if (currprefs.a2065name[0])
+		device_add_rethink(rethink_a2065);
+#endif
+#ifdef A2091
+	device_add_rethink(rethink_a2091);
+#endif
+#ifdef CDTV
+	if (currprefs.cs_cdtvcd)
+		device_add_rethink(rethink_cdtv);
+	if (currprefs.cs_cdtvcr)
+		device_add_rethink(rethink_cdtvcr);
+#endif
+#ifdef CD32
+	if (currprefs.cs_cd32cd)
+		device_add_rethink(rethink_akiko);
+	if (currprefs.cs_cd32fmv)
+		device_add_rethink_irq(rethink_cd32fmv, DEVICE_ID_CD32FMV);
+#endif
+#ifdef NCR
+	device_add_rethink(ncr_rethink);
+#endif
+#ifdef NCR9X
+	device_add_rethink(ncr9x_rethink);
+#endif
+	device_add_rethink(ncr80_rethink);
+#ifdef WITH_TOCCATA
+	if (currprefs.sound_toccata)
+		device_add_rethink(sndboard_rethink);
+#endif
+	if (currprefs.cs_ide || currprefs.cs_pcmcia)
+		device_add_rethink(rethink_gayle);
+	device_add_rethink_irq(idecontroller_rethink, DEVICE_ID_IDE);
+	/* cpuboard_rethink must be last */
+	device_add_rethink(cpuboard_rethink);
+}
+
 void devices_reset(int hardreset)
 {
+	devices_build_handlers();
 	gayle_reset (hardreset);
 	idecontroller_reset();
 	a1000_reset ();
@@ -125,77 +309,48 @@ void devices_vsync_post(void)
 
 void devices_hsync(void)
 {
-	#ifdef A2065
-	a2065_hsync_handler ();
-#endif
-#ifdef CD32
-	AKIKO_hsync_handler ();
-	cd32_fmv_hsync_handler();
-#endif
-#ifdef CDTV
-	CDTV_hsync_handler ();
-	CDTVCR_hsync_handler ();
-#endif
-	decide_blitter (-1);
-
-#ifdef PICASSO96
-	picasso_handle_hsync ();
-#endif
-#ifdef AHI
-	{
-		void ahi_hsync (void);
-		ahi_hsync ();
+	for (int i = 0; i < DEVICE_ID_MAX; i++) {
+		int req = device_wake_req[i];
+		if (req != device_wake_seen[i]) {
+			device_wake_seen[i] = req;
+			device_wake_lines[i] = DEVICE_WAKE_LINES;
+		}
+	}
+	for (int i = 0; i < device_hsync_cnt; i++) {
+		struct device_item *di = &device_hsyncs[i];
+		if (di->id >= 0 && !device_wake_lines[di->id])
+			continue;
+		di->func();
+	}
+	for (int i = 0; i < DEVICE_ID_MAX; i++) {
+		if (device_wake_lines[i] > 0)
+			device_wake_lines[i]--;
 	}
-#endif
-#ifdef WITH_PPC
-	uae_ppc_hsync_handler();
-	cpuboard_hsync();
-#endif
-#ifdef WITH_TOCCATA
-	sndboard_hsync();
-#endif
-	DISK_hsync ();
-	audio_hsync ();
-	CIA_hsync_prehandler ();
-	serial_hsynchandler ();
-	gayle_hsync ();
-	idecontroller_hsync();
-#ifdef A2091
-	scsi_hsync ();
-#endif
 }
 
 void devices_rethink(void)
 {
-	rethink_cias ();
-#ifdef A2065
-	rethink_a2065 ();
-#endif
-#ifdef A2091
-	rethink_a2091 ();
-#endif
-#ifdef CDTV
-	rethink_cdtv();
-	rethink_cdtvcr();
-#endif
-#ifdef CD32
-	rethink_akiko ();
-	rethink_cd32fmv();
-#endif
-#ifdef NCR
-	ncr_rethink();
-#endif
-#ifdef NCR9X
-	ncr9x_rethink();
-#endif
-	ncr80_rethink();
-#ifdef WITH_TOCCATA
-	sndboard_rethink();
-#endif
-	rethink_gayle ();
-	idecontroller_rethink();
-	/* cpuboard_rethink must be last */
-	cpuboard_rethink();
+	uae_u32 mask = device_irq_dirty_mask | device_irq_active;
+
+	device_irq_dirty_mask = 0;
+	for (int i = 0; i < DEVICE_ID_MAX; i++) {
+		if (device_wake_lines[i])
+			mask |= 1 << i;
+	}
+	for (int i = 0; i < device_rethink_cnt; i++) {
+		struct device_item *di = &device_rethinks[i];
+		if (di->irq) {
+			uae_u32 bit = 1 << di->id;
+			if (!(mask & bit))
+				continue;
+			if (di->irq())
+				device_irq_active |= bit;
+			else
+				device_irq_active &= ~bit;
+		} else {
+			di->func();
+		}
+	}
 }
 
 void devices_update_sound(double clk, double syncadjust)
@@ -265,6 +420,7 @@ void do_leave_program (void)
 	DISK_free ();
 	close_sound ();
 	dump_counts ();
+	custom_wstats_free ();
 #ifdef SERIAL_PORT
 	serial_exit ();
 #endif
@@ -48,6 +48,8 @@ int disk_debug_track = -1;
 #include "scp.h"
 #endif
 #include "crc32.h"
+#include "diskutil.h"
+#include "threaddep/thread.h"
 #include "inputrecord.h"
 #include "amax.h"
 #ifdef RETROPLATFORM
@@ -162,6 +164,7 @@ typedef struct {
 	drive_filetype filetype;
 	trackid trackdata[MAX_TRACKS];
 	trackid writetrackdata[MAX_TRACKS];
+	uae_u16 *mfmcache[MAX_TRACKS]; /* already encoded AmigaDOS tracks */
 	int buffered_cyl, buffered_side;
 	int cyl;
 	bool motoroff;
@@ -616,6 +619,100 @@ static void drive_settype_id (drive *drv)
 #endif
 }
 
+#ifdef SCP
+/* next flux revolution, decoded by the disk thread while the current one is read */
+struct revprefetch
+{
+	uae_u16 *mfm;
+	uae_u16 *timing;
+	int tracklen;
+	bool pending;
+	uae_sem_t done;
+};
+static struct revprefetch revprefetch[MAX_FLOPPY_DRIVES];
+static volatile int revprefetch_running;
+static smp_comm_pipe revprefetch_requests;
+
+static void *revprefetch_thread (void *null)
+{
+	for (;;) {
+		int dr = (int)read_comm_pipe_u32_blocking (&revprefetch_requests);
+		if (dr < 0)
+			break;
+		struct revprefetch *rp = &revprefetch[dr];
+		scp_loadrevolution (rp->mfm, dr, rp->timing, &rp->tracklen);
+		uae_sem_post (&rp->done);
+	}
+	revprefetch_running = -1;
+	return 0;
+}
+
+static void revprefetch_start (drive *drv)
+{
+	int dr = drv - floppy;
+	struct revprefetch *rp = &revprefetch[dr];
+
+	if (drv->filetype != ADF_SCP || !drv->multi_revolution || rp->pending)
+		return;
+	if (!revprefetch_running) {
+		for (int i = 0; i < MAX_FLOPPY_DRIVES; i++)
+			uae_sem_init (&revprefetch[i].done, 0, 0);
+		init_comm_pipe (&revprefetch_requests, 10, 1);
+		revprefetch_running = 1;
+		uae_start_thread (_T("disk"), revprefetch_thread, 0, NULL);
+	}
+	if (!rp->mfm) {
+		rp->mfm = xmalloc (uae_u16, 0x4000 * DDHDMULT);
+		rp->timing = xmalloc (uae_u16, 0x4000 * DDHDMULT);
+	}
+	rp->pending = true;
+	write_comm_pipe_u32 (&revprefetch_requests, dr, 1);
+}
+
+/* must be called before anything else touches the drive's SCP state */
+static bool revprefetch_wait (drive *drv)
+{
+	struct revprefetch *rp = &revprefetch[drv - floppy];
+
+	if (!rp->pending)
+		return false;
+	uae_sem_wait (&rp->done);
+	rp->pending = false;
+	return true;
+}
+
+static void revprefetch_free (void)
+{
+	if (revprefetch_running > 0) {
+		write_comm_pipe_u32 (&revprefetch_requests, (uae_u32)-1, 1);
+		while (revprefetch_running > 0)
+			sleep_millis (1);
+		destroy_comm_pipe (&revprefetch_requests);
+		for (int i = 0; i < MAX_FLOPPY_DRIVES; i++)
+			uae_sem_destroy (&revprefetch[i].done);
+	}
+	revprefetch_running = 0;
+	for (int i = 0; i < MAX_FLOPPY_DRIVES; i++) {
+		struct revprefetch *rp = &revprefetch[i];
+		xfree (rp->mfm);
+		xfree (rp->timing);
+		rp->mfm = rp->timing = NULL;
+		rp->pending = false;
+	}
+}
+#endif
+
+/* TR < 0: all tracks */
+static void drive_mfmcache_free (drive *drv, int tr)
+{
+	for (int i = 0; i < MAX_TRACKS; i++) {
+		if (tr >= 0 && i != tr)
+			continue;
+		xfree (drv->mfmcache[i]);
+		drv->mfmcache[i] = NULL;
+	}
+}
+
 static void drive_image_free (drive *drv)
 {
 	switch (drv->filetype)
@@ -627,6 +724,7 @@ static void drive_image_free (drive *drv)
 		break;
 	case ADF_SCP:
 #ifdef SCP
+		revprefetch_wait (drv);
 		scp_close (drv - floppy);
 #endif
 		break;
@@ -638,6 +736,7 @@ static void drive_image_free (drive *drv)
 		break;
 	}
 	drv->filetype = ADF_NONE;
+	drive_mfmcache_free (drv, -1);
 	zfile_fclose (drv->diskfile);
 	drv->diskfile = NULL;
 	zfile_fclose (drv->writediskfile);
@@ -1539,48 +1638,14 @@ static void read_floppy_data (struct zfile *diskfile, int type, trackid *tid, in
 	}
 }
 
-/* Megalomania does not like zero MFM words... */
-static void mfmcode (uae_u16 * mfm, int words)
-{
-	uae_u32 lastword = 0;
-	while (words--) {
-		uae_u32 v = (*mfm) & 0x55555555;
-		uae_u32 lv = (lastword << 16) | v;
-		uae_u32 nlv = 0x55555555 & ~lv;
-		uae_u32 mfmbits = (nlv << 1) & (nlv >> 1);
-		*mfm++ = v | mfmbits;
-		lastword = v;
-	}
-}
-
-static uae_u8 mfmencodetable[16] = {
-	0x2a, 0x29, 0x24, 0x25, 0x12, 0x11, 0x14, 0x15,
-	0x4a, 0x49, 0x44, 0x45, 0x52, 0x51, 0x54, 0x55
-};
-
-
-static uae_u16 dos_encode_byte (uae_u8 byte)
-{
-	uae_u8 b2, b1;
-	uae_u16 word;
-
-	b1 = byte;
-	b2 = b1 >> 4;
-	b1 &= 15;
-	word = mfmencodetable[b2] <<8 | mfmencodetable[b1];
-	return (word | ((word & (256 | 64)) ? 0 : 128));
-}
-
 static uae_u16 *mfmcoder (uae_u8 *src, uae_u16 *dest, int len)
 {
 	int i;
 
-	for (i = 0; i < len; i++) {
-		*dest = dos_encode_byte (*src++);
-		*dest |= ((dest[-1] & 1)||(*dest & 0x4000)) ? 0: 0x8000;
-		dest++;
-	}
-	return dest;
+	for (i = 0; i < len; i++)
+		dest[i] = mfm_encode_byte (src[i]);
+	mfm_clock (dest, len, dest[-1]);
+	return dest + len;
 }
 
 static void decode_pcdos (drive *drv)
@@ -1660,18 +1725,26 @@ static void decode_amigados (drive *drv)
 	int prevbit;
 
 	trackid *ti = drv->trackdata + tr;
-	memset (dstmfmbuf, 0xaa, len * 2);
-	dstmfmoffset += FLOPPY_GAP_LEN;
 	drv->skipoffset = (FLOPPY_GAP_LEN * 8) / 3 * 2;
 	drv->tracklen = len * 2 * 8;
 
+	if (drv->mfmcache[tr]) {
+		memcpy (dstmfmbuf, drv->mfmcache[tr], len * 2);
+		if (disk_debug_logging > 0)
+			write_log (_T("amigados read track %d (cached)\n"), tr);
+		return;
+	}
+
+	memset (dstmfmbuf, 0xaa, len * 2);
+	dstmfmoffset += FLOPPY_GAP_LEN;
+
 	prevbit = 0;
 	for (sec = 0; sec < drv->num_secs; sec++) {
 		uae_u8 secbuf[544];
 		uae_u16 mfmbuf[544 + 1];
 		int i;
 		uae_u32 deven, dodd;
-		uae_u32 hck = 0, dck = 0;
+		uae_u32 hck = 0, dck;
 
 		secbuf[0] = secbuf[1] = 0x00;
 		secbuf[2] = secbuf[3] = 0xa1;
@@ -1689,30 +1762,11 @@ static void decode_amigados (drive *drv)
 		mfmbuf[1] = 0xaaaa;
 		mfmbuf[2] = mfmbuf[3] = 0x4489;
 
-		deven = ((secbuf[4] << 24) | (secbuf[5] << 16)
-			| (secbuf[6] << 8) | (secbuf[7]));
-		dodd = deven >> 1;
-		deven &= 0x55555555;
-		dodd &= 0x55555555;
-
-		mfmbuf[4] = dodd >> 16;
-		mfmbuf[5] = dodd;
-		mfmbuf[6] = deven >> 16;
-		mfmbuf[7] = deven;
+		mfm_encode_oddeven (secbuf + 4, mfmbuf + 4, mfmbuf + 6, 4);
 
 		for (i = 8; i < 48; i++)
 			mfmbuf[i] = 0xaaaa;
-		for (i = 0; i < 512; i += 4) {
-			deven = ((secbuf[i + 32] << 24) | (secbuf[i + 33] << 16)
-				| (secbuf[i + 34] << 8) | (secbuf[i + 35]));
-			dodd = deven >> 1;
-			deven &= 0x55555555;
-			dodd &= 0x55555555;
-			mfmbuf[(i >> 1) + 32] = dodd >> 16;
-			mfmbuf[(i >> 1) + 33] = dodd;
-			mfmbuf[(i >> 1) + 256 + 32] = deven >> 16;
-			mfmbuf[(i >> 1) + 256 + 33] = deven;
-		}
+		dck = mfm_encode_oddeven (secbuf + 32, mfmbuf + 32, mfmbuf + 256 + 32, 512);
 
 		for (i = 4; i < 24; i += 2)
 			hck ^= (mfmbuf[i] << 16) | mfmbuf[i + 1];
@@ -1724,9 +1778,6 @@ static void decode_amigados (drive *drv)
 		mfmbuf[26] = deven >> 16;
 		mfmbuf[27] = deven;
 
-		for (i = 32; i < 544; i += 2)
-			dck ^= (mfmbuf[i] << 16) | mfmbuf[i + 1];
-
 		deven = dodd = dck;
 		dodd >>= 1;
 		mfmbuf[28] = dodd >> 16;
@@ -1736,7 +1787,7 @@ static void decode_amigados (drive *drv)
 
 		mfmbuf[544] = 0;
 
-		mfmcode (mfmbuf + 4, 544 - 4 + 1);
+		mfm_clock (mfmbuf + 4, 544 - 4 + 1, 0);
 
 		for (i = 0; i < 544; i++) {
 			dstmfmbuf[dstmfmoffset % len] = mfmbuf[i];
@@ -1747,6 +1798,10 @@ static void decode_amigados (drive *drv)
 		dstmfmbuf[dstmfmoffset % len] = mfmbuf[i];
 	}
 
+	drv->mfmcache[tr] = xmalloc (uae_u16, len);
+	if (drv->mfmcache[tr])
+		memcpy (drv->mfmcache[tr], dstmfmbuf, len * 2);
+
 	if (disk_debug_logging > 0)
 		write_log (_T("amigados read track %d\n"), tr);
 }
@@ -1807,7 +1862,7 @@ static void decode_diskspare (drive *drv)
 			mfmbuf[i + 8 + 2] = deven >> 16;
 			mfmbuf[i + 8 + 3] = deven;
 		}
-		mfmcode (mfmbuf + 8, 512);
+		mfm_clock (mfmbuf + 8, 512, 0);
 
 		i = 8;
 		chk = mfmbuf[i++] & 0x7fff;
@@ -1826,7 +1881,7 @@ static void decode_diskspare (drive *drv)
 		mfmbuf[5] = dodd;
 		mfmbuf[6] = deven >> 16;
 		mfmbuf[7] = deven;
-		mfmcode (mfmbuf + 4, 4);
+		mfm_clock (mfmbuf + 4, 4, 0);
 
 		for (i = 0; i < 512 + 8; i++) {
 			dstmfmbuf[dstmfmoffset % len] = mfmbuf[i];
@@ -1901,7 +1956,9 @@ static void drive_fill_bigbuf (drive * drv, int force)
 	} else if (drv->filetype == ADF_SCP) {
 
 #ifdef SCP
-		scp_loadtrack (drv->bigmfmbuf, drv->tracktiming, drv - floppy, tr, &drv->tracklen, &drv->multi_revolution, &drv->skipoffset, &drv->lastrev, retrytrack);
+		revprefetch_wait (drv);
+		if (scp_loadtrack (drv->bigmfmbuf, drv->tracktiming, drv - floppy, tr, &drv->tracklen, &drv->multi_revolution, &drv->skipoffset, &drv->lastrev, retrytrack))
+			revprefetch_start (drv);
 #endif
 
 	} else if (drv->filetype == ADF_FDI) {
@@ -1992,18 +2049,18 @@ static uae_u32 getmfmlong (uae_u16 *mbuf, int shift)
 static void check_valid_mfm (uae_u16 *mbuf, int words, int sector)
 {
 	int prevbit = 0;
-	for (int i = 0; i < words * 8; i++) {
-		int wordoffset = i / 8;
-		uae_u16 w = mbuf[wordoffset];
-		uae_u16 wp = mbuf[wordoffset - 1];
-		int bitoffset = (7 - (i & 7)) * 2;
-		int clockbit = w & (1 << (bitoffset + 1));
-		int databit = w & (1 << (bitoffset + 0));
-
-		if ((clockbit && databit) || (clockbit && !databit && prevbit) || (!clockbit && !databit && !prevbit)) {
-			write_log (L"illegal mfm sector %d data %04x %04x, bit %d:%d\n", sector, wp, w, wordoffset, bitoffset);
+	for (int i = 0; i < words; i++) {
+		uae_u16 w = mbuf[i];
+		uae_u16 d = w & 0x5555;
+		uae_u16 c = (w >> 1) & 0x5555;
+		// data bit of the previous cell
+		uae_u16 p = (d >> 2) | (prevbit << 14);
+		uae_u16 bad = (c & (d | p)) | (~(c | d | p) & 0x5555);
+
+		if (bad) {
+			write_log (L"illegal mfm sector %d data %04x %04x, word %d mask %04x\n", sector, mbuf[i - 1], w, i, bad);
 		}
-		prevbit = databit;
+		prevbit = w & 1;
 	}
 }
 #endif
@@ -2014,7 +2071,6 @@ static int decode_buffer (uae_u16 *mbuf, int cyl, int drvsec, int ddhd, int file
 	int fwlen = FLOPPY_WRITE_LEN * ddhd;
 	int length = 2 * fwlen;
 	uae_u32 odd, even, chksum, id, dlong;
-	uae_u8 *secdata;
 	uae_u8 secbuf[544];
 	uae_u16 *mend = mbuf + length, *mstart;
 	uae_u32 sechead[4];
@@ -2098,18 +2154,8 @@ static int decode_buffer (uae_u16 *mbuf, int cyl, int drvsec, int ddhd, int file
 		even = getmfmlong (mbuf + 2, shift);
 		mbuf += 4;
 		chksum = (odd << 1) | even;
-		secdata = secbuf + 32;
-		for (i = 0; i < 128; i++) {
-			odd = getmfmlong (mbuf, shift);
-			even = getmfmlong (mbuf + 256, shift);
-			mbuf += 2;
-			dlong = (odd << 1) | even;
-			*secdata++ = dlong >> 24;
-			*secdata++ = dlong >> 16;
-			*secdata++ = dlong >> 8;
-			*secdata++ = dlong;
-			chksum ^= odd ^ even;
-		}
+		chksum ^= mfm_decode_oddeven (mbuf, mbuf + 256, shift, secbuf + 32, 512);
+		mbuf += 256;
 		if (chksum) {
 			write_log (_T("Disk decode: sector %d, data checksum error\n"), trackoffs);
 			if (filetype == ADF_EXT2)
@@ -2135,18 +2181,9 @@ static int decode_buffer (uae_u16 *mbuf, int cyl, int drvsec, int ddhd, int file
 static uae_u8 mfmdecode (uae_u16 **mfmp, int shift)
 {
 	uae_u16 mfm = getmfmword (*mfmp, shift);
-	uae_u8 out = 0;
-	int i;
 
 	(*mfmp)++;
-	mfm &= 0x5555;
-	for (i = 0; i < 8; i++) {
-		out >>= 1;
-		if (mfm & 1)
-			out |= 0x80;
-		mfm >>= 2;
-	}
-	return out;
+	return mfm_decode_byte (mfm);
 }
 
 static int drive_write_pcdos (drive *drv)
@@ -2348,6 +2385,7 @@ static void drive_write_data (drive * drv)
 	int ret = -1;
 	int tr = drv->cyl * 2 + side;
 
+	drive_mfmcache_free (drv, tr);
 	if (drive_writeprotected (drv) || drv->trackdata[tr].type == TRACK_NONE) {
 		/* read original track back because we didn't really write anything */
 		drv->buffered_side = 2;
@@ -3075,7 +3113,15 @@ static void fetchnextrevolution (drive *drv)
 		break;
 	case ADF_SCP:
 #ifdef SCP
-		scp_loadrevolution (drv->bigmfmbuf, drv - floppy, drv->tracktiming, &drv->tracklen);
+		if (revprefetch_wait (drv)) {
+			struct revprefetch *rp = &revprefetch[drv - floppy];
+			drv->tracklen = rp->tracklen;
+			memcpy (drv->bigmfmbuf, rp->mfm, ((rp->tracklen + 15) / 16) * sizeof (uae_u16));
+			memcpy (drv->tracktiming, rp->timing, ((rp->tracklen + 7) / 8) * sizeof (uae_u16));
+		} else {
+			scp_loadrevolution (drv->bigmfmbuf, drv - floppy, drv->tracktiming, &drv->tracklen);
+		}
+		revprefetch_start (drv);
 #endif
 		break;
 	case ADF_FDI:
@@ -3633,6 +3679,52 @@ void DISK_update (int tohpos)
 	disk_doupdate_predict (disk_hpos);
 }
 
+/* Track is generated from sector data, turbo DMA can't be told apart from real one */
+static bool disk_turbo_track (drive *drv)
+{
+	int tr = drv->cyl * 2 + side;
+
+	if (drv->filetype == ADF_NORMAL || drv->filetype == ADF_KICK || drv->filetype == ADF_SKICK)
+		return true;
+	// extended ADF: standard AmigaDOS track read using standard sync
+	if (drv->filetype != ADF_EXT1 && drv->filetype != ADF_EXT2)
+		return false;
+	if (dskdmaen != DSKDMA_READ || !(adkcon & 0x400) || dsksync != 0x4489)
+		return false;
+	if (tr >= drv->num_tracks || drv->trackdata[tr].type != TRACK_AMIGADOS)
+		return false;
+	if (drv->writediskfile && drv->writetrackdata[tr].bitlen > 0)
+		return false;
+	return true;
+}
+
+/* TURBO read: copy remaining DMA length from track buffer, returns new mfm position */
+static int disk_turbo_read (drive *drv, int pos)
+{
+	uae_u32 size;
+	uae_u8 *mem = memwatch_enabled ? NULL : chipmem_dma_base (&size);
+
+	if (mem && !(dskpt & 1) && dskpt + dsklength * 2 <= size && !(drv->tracklen & 15) && !(pos & 15)) {
+		uae_u16 *dst = (uae_u16 *)(mem + dskpt);
+		int w = pos >> 4, tw = drv->tracklen >> 4;
+		for (int i = 0; i < dsklength; i++) {
+			do_put_mem_word (dst + i, drv->bigmfmbuf[w]);
+			if (++w == tw)
+				w = 0;
+		}
+		dskpt += dsklength * 2;
+		dsklength = -1;
+		return w << 4;
+	}
+	while (dsklength-- > 0) {
+		chipmem_wput_indirect (dskpt, drv->bigmfmbuf[pos >> 4]);
+		dskpt += 2;
+		pos += 16;
+		pos %= drv->tracklen;
+	}
+	return pos;
+}
+
 void DSKLEN (uae_u16 v, int hpos)
 {
 	int dr, prev = dsklen;
@@ -3754,10 +3846,10 @@ void DSKLEN (uae_u16 v, int hpos)
 		drive *drv = &floppy[dr];
 		if (selected & (1 << dr))
 			continue;
-		if (drv->filetype != ADF_NORMAL && drv->filetype != ADF_KICK && drv->filetype != ADF_SKICK)
+		if (!disk_turbo_track (drv))
 			break;
 	}
-	if (dr < MAX_FLOPPY_DRIVES) /* no turbo mode if any selected drive has non-standard ADF */
+	if (dr < MAX_FLOPPY_DRIVES) /* no turbo mode if any selected drive has non-standard track */
 		return;
 	{
 		int done = 0;
@@ -3791,13 +3883,7 @@ void DSKLEN (uae_u16 v, int hpos)
 					if (i >= drv->tracklen)
 						return;
 				}
-				while (dsklength-- > 0) {
-					chipmem_wput_indirect (dskpt, drv->bigmfmbuf[pos >> 4]);
-					dskpt += 2;
-					pos += 16;
-					pos %= drv->tracklen;
-				}
-				drv->mfmpos = pos;
+				drv->mfmpos = disk_turbo_read (drv, pos);
 				INTREQ (0x8000 | 0x1000);
 				done = 2;
 
@@ -3953,6 +4039,9 @@ void DISK_free (void)
 		drive *drv = &floppy[dr];
 		drive_image_free (drv);
 	}
+#ifdef SCP
+	revprefetch_free ();
+#endif
 }
 
 void DISK_init (void)
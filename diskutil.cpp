@@ -2,8 +2,240 @@
 #include "sysdeps.h"
 
 #include "crc32.h"
+#include "options.h"
+#include "events.h"
+#include "diskutil.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define DISKUTIL_SSE2 1
+#include <emmintrin.h>
+#endif
 
 #define MFMMASK 0x55555555
+
+static int mfm_simd = 1;
+
+#if DISKUTIL_SSE2
+STATIC_INLINE __m128i mfm_swap16 (__m128i v)
+{
+	return _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+}
+// xor of four big endian longs
+STATIC_INLINE uae_u32 mfm_fold_be (__m128i x)
+{
+	uae_u32 v;
+	x = _mm_xor_si128 (x, _mm_shuffle_epi32 (x, 0x4e));
+	x = _mm_xor_si128 (x, _mm_shuffle_epi32 (x, 0xb1));
+	v = _mm_cvtsi128_si32 (x);
+	return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+#endif
+
+// data bits only, clock bits are added by mfm_clock()
+uae_u16 mfm_encode_byte (uae_u8 v)
+{
+	uae_u16 x = v;
+	x = (x | (x << 4)) & 0x0f0f;
+	x = (x | (x << 2)) & 0x3333;
+	x = (x | (x << 1)) & 0x5555;
+	return x;
+}
+
+uae_u8 mfm_decode_byte (uae_u16 mfm)
+{
+	uae_u16 x = mfm & 0x5555;
+	x = (x | (x >> 1)) & 0x3333;
+	x = (x | (x >> 2)) & 0x0f0f;
+	x = (x | (x >> 4)) & 0x00ff;
+	return (uae_u8)x;
+}
+
+/* Megalomania does not like zero MFM words... */
+void mfm_clock (uae_u16 *mfm, int words, uae_u16 prev)
+{
+	uae_u32 lastword = prev & 0x5555;
+	int i = 0;
+#if DISKUTIL_SSE2
+	if (mfm_simd && words > 8) {
+		__m128i m = _mm_set1_epi16 (0x5555), m1 = _mm_set1_epi16 (1);
+		mfm_clock (mfm, 1, prev);
+		for (i = 1; i + 8 <= words; i += 8) {
+			__m128i v = _mm_and_si128 (_mm_loadu_si128 ((__m128i*)(mfm + i)), m);
+			__m128i p = _mm_loadu_si128 ((__m128i*)(mfm + i - 1));
+			__m128i n = _mm_andnot_si128 (v, m);
+			__m128i hi = _mm_or_si128 (_mm_srli_epi16 (n, 1), _mm_slli_epi16 (_mm_andnot_si128 (p, m1), 15));
+			_mm_storeu_si128 ((__m128i*)(mfm + i), _mm_or_si128 (v, _mm_and_si128 (_mm_slli_epi16 (n, 1), hi)));
+		}
+		lastword = mfm[i - 1] & 0x5555;
+	}
+#endif
+	for (; i < words; i++) {
+		uae_u32 v = mfm[i] & 0x5555;
+		uae_u32 nlv = 0x55555555 & ~((lastword << 16) | v);
+		uae_u32 mfmbits = (nlv << 1) & (nlv >> 1);
+		mfm[i] = v | mfmbits;
+		lastword = v;
+	}
+}
+
+// AmigaDOS odd/even split of big endian longs, returns xor of all odd and even longs
+uae_u32 mfm_encode_oddeven (const uae_u8 *src, uae_u16 *odd, uae_u16 *even, int bytes)
+{
+	uae_u32 chk = 0;
+	int i = 0;
+#if DISKUTIL_SSE2
+	if (mfm_simd) {
+		__m128i m = _mm_set1_epi8 (0x55), x = _mm_setzero_si128 ();
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i v = _mm_loadu_si128 ((const __m128i*)(src + i));
+			__m128i o = _mm_and_si128 (_mm_srli_epi16 (v, 1), m);
+			__m128i e = _mm_and_si128 (v, m);
+			x = _mm_xor_si128 (x, _mm_xor_si128 (o, e));
+			_mm_storeu_si128 ((__m128i*)(odd + i / 2), mfm_swap16 (o));
+			_mm_storeu_si128 ((__m128i*)(even + i / 2), mfm_swap16 (e));
+		}
+		chk = mfm_fold_be (x);
+	}
+#endif
+	for (; i < bytes; i += 4) {
+		uae_u32 v = (src[i] << 24) | (src[i + 1] << 16) | (src[i + 2] << 8) | src[i + 3];
+		uae_u32 o = (v >> 1) & MFMMASK;
+		uae_u32 e = v & MFMMASK;
+		odd[i / 2 + 0] = (uae_u16)(o >> 16);
+		odd[i / 2 + 1] = (uae_u16)o;
+		even[i / 2 + 0] = (uae_u16)(e >> 16);
+		even[i / 2 + 1] = (uae_u16)e;
+		chk ^= o ^ e;
+	}
+	return chk;
+}
+
+// odd/even join from a bit shifted word stream, returns xor of all odd and even longs
+uae_u32 mfm_decode_oddeven (const uae_u16 *odd, const uae_u16 *even, int shift, uae_u8 *dst, int bytes)
+{
+	uae_u32 chk = 0;
+	int i = 0;
+#if DISKUTIL_SSE2
+	if (mfm_simd) {
+		__m128i m = _mm_set1_epi16 (0x5555), x = _mm_setzero_si128 ();
+		__m128i ls = _mm_cvtsi32_si128 (shift);
+		__m128i rs = _mm_cvtsi32_si128 (16 - shift);
+		for (; i + 16 <= bytes; i += 16) {
+			const uae_u16 *op = odd + i / 2, *ep = even + i / 2;
+			__m128i o = _mm_or_si128 (_mm_sll_epi16 (_mm_loadu_si128 ((const __m128i*)op), ls), _mm_srl_epi16 (_mm_loadu_si128 ((const __m128i*)(op + 1)), rs));
+			__m128i e = _mm_or_si128 (_mm_sll_epi16 (_mm_loadu_si128 ((const __m128i*)ep), ls), _mm_srl_epi16 (_mm_loadu_si128 ((const __m128i*)(ep + 1)), rs));
+			o = _mm_and_si128 (o, m);
+			e = _mm_and_si128 (e, m);
+			x = _mm_xor_si128 (x, _mm_xor_si128 (o, e));
+			_mm_storeu_si128 ((__m128i*)(dst + i), mfm_swap16 (_mm_or_si128 (_mm_slli_epi16 (o, 1), e)));
+		}
+		chk = mfm_fold_be (mfm_swap16 (x));
+	}
+#endif
+	for (; i < bytes; i += 4) {
+		const uae_u16 *op = odd + i / 2, *ep = even + i / 2;
+		uae_u32 o = ((uae_u16)((op[0] << shift) | (op[1] >> (16 - shift))) << 16) | (uae_u16)((op[1] << shift) | (op[2] >> (16 - shift)));
+		uae_u32 e = ((uae_u16)((ep[0] << shift) | (ep[1] >> (16 - shift))) << 16) | (uae_u16)((ep[1] << shift) | (ep[2] >> (16 - shift)));
+		uae_u32 d;
+		o &= MFMMASK;
+		e &= MFMMASK;
+		d = (o << 1) | e;
+		dst[i + 0] = (uae_u8)(d >> 24);
+		dst[i + 1] = (uae_u8)(d >> 16);
+		dst[i + 2] = (uae_u8)(d >> 8);
+		dst[i + 3] = (uae_u8)d;
+		chk ^= o ^ e;
+	}
+	return chk;
+}
+
+// same from a big endian byte stream
+uae_u32 mfm_decode_oddeven_b (const uae_u8 *odd, const uae_u8 *even, uae_u8 *dst, int bytes)
+{
+	uae_u32 chk = 0;
+	int i = 0;
+#if DISKUTIL_SSE2
+	if (mfm_simd) {
+		__m128i m = _mm_set1_epi8 (0x55), x = _mm_setzero_si128 ();
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i o = _mm_and_si128 (_mm_loadu_si128 ((const __m128i*)(odd + i)), m);
+			__m128i e = _mm_and_si128 (_mm_loadu_si128 ((const __m128i*)(even + i)), m);
+			x = _mm_xor_si128 (x, _mm_xor_si128 (o, e));
+			_mm_storeu_si128 ((__m128i*)(dst + i), _mm_or_si128 (_mm_slli_epi16 (o, 1), e));
+		}
+		chk = mfm_fold_be (x);
+	}
+#endif
+	for (; i < bytes; i += 4) {
+		uae_u32 o = ((odd[i] << 24) | (odd[i + 1] << 16) | (odd[i + 2] << 8) | odd[i + 3]) & MFMMASK;
+		uae_u32 e = ((even[i] << 24) | (even[i + 1] << 16) | (even[i + 2] << 8) | even[i + 3]) & MFMMASK;
+		uae_u32 d = (o << 1) | e;
+		dst[i + 0] = (uae_u8)(d >> 24);
+		dst[i + 1] = (uae_u8)(d >> 16);
+		dst[i + 2] = (uae_u8)(d >> 8);
+		dst[i + 3] = (uae_u8)d;
+		chk ^= o ^ e;
+	}
+	return chk;
+}
+
+#define MFMBENCH_TRACKS (2 * 80)
+#define MFMBENCH_SECS 11
+
+// encode and decode data area of a full 80 cylinder DD disk
+void mfm_benchmark (int loops)
+{
+	uae_u8 *data = xmalloc (uae_u8, MFMBENCH_TRACKS * MFMBENCH_SECS * 512);
+	uae_u8 *out = xmalloc (uae_u8, MFMBENCH_TRACKS * MFMBENCH_SECS * 512);
+	uae_u16 *mfm = xmalloc (uae_u16, 512 + 1);
+	uae_u32 seed = 0x12345678;
+	uae_u32 sums[2];
+	int modes = 1;
+	int errors = 0;
+
+	if (loops <= 0)
+		loops = 10;
+	for (int i = 0; i < MFMBENCH_TRACKS * MFMBENCH_SECS * 512; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (uae_u8)(seed >> 16);
+	}
+#if DISKUTIL_SSE2
+	modes = 2;
+#endif
+	for (int mode = 0; mode < modes; mode++) {
+		frame_time_t t;
+		uae_u32 sum = 0;
+		mfm_simd = mode;
+		memset (out, 0, MFMBENCH_TRACKS * MFMBENCH_SECS * 512);
+		t = read_processor_time ();
+		for (int l = 0; l < loops; l++) {
+			for (int s = 0; s < MFMBENCH_TRACKS * MFMBENCH_SECS; s++) {
+				uae_u32 echk, dchk;
+				mfm[512] = 0;
+				echk = mfm_encode_oddeven (data + s * 512, mfm, mfm + 256, 512);
+				mfm_clock (mfm, 512 + 1, 0);
+				dchk = mfm_decode_oddeven (mfm, mfm + 256, 0, out + s * 512, 512);
+				if (echk != dchk)
+					errors++;
+				sum ^= echk + s;
+			}
+		}
+		t = read_processor_time () - t;
+		if (memcmp (data, out, MFMBENCH_TRACKS * MFMBENCH_SECS * 512))
+			errors++;
+		sums[mode] = sum;
+		console_out_f (_T("%s: %d disks in %.3fs, %.1f disks/s\n"), mode ? _T("SSE2") : _T("C"),
+			loops, (double)t / syncbase, t > 0 ? (double)loops * syncbase / t : 0.0);
+	}
+	if (modes > 1 && sums[0] != sums[1])
+		errors++;
+	mfm_simd = 1;
+	console_out_f (_T("%d errors.\n"), errors);
+	xfree (mfm);
+	xfree (out);
+	xfree (data);
+}
+
 static uae_u32 getmfmlong (uae_u16 * mbuf)
 {
 	return (uae_u32)(((*mbuf << 16) | *(mbuf + 1)) & MFMMASK);
@@ -15,7 +247,6 @@ static int drive_write_adf_amigados (uae_u16 *mbuf, uae_u16 *mend, uae_u8 *write
 {
 	int i;
 	uae_u32 odd, even, chksum, id, dlong;
-	uae_u8 *secdata;
 	uae_u8 secbuf[544];
 
 	mend -= (4 + 16 + 8 + 512);
@@ -76,19 +307,8 @@ static int drive_write_adf_amigados (uae_u16 *mbuf, uae_u16 *mend, uae_u8 *write
 		even = getmfmlong (mbuf + 2);
 		mbuf += 4;
 		chksum = (odd << 1) | even;
-		secdata = secbuf + 32;
-		for (i = 0; i < 128; i++) {
-			odd = getmfmlong (mbuf);
-			even = getmfmlong (mbuf + 256);
-			mbuf += 2;
-			dlong = (odd << 1) | even;
-			*secdata++ = (uae_u8)(dlong >> 24);
-			*secdata++ = (uae_u8)(dlong >> 16);
-			*secdata++ = (uae_u8)(dlong >> 8);
-			*secdata++ = (uae_u8)dlong;
-			chksum ^= odd ^ even;
-		}
-		mbuf += 256;
+		chksum ^= mfm_decode_oddeven (mbuf, mbuf + 256, 0, secbuf + 32, 512);
+		mbuf += 512;
 		if (chksum) {
 			write_log (_T("* track %d, sector %d data crc error\n"), track, trackoffs);
 			goto next;
@@ -142,18 +362,9 @@ static uae_u16 getmfmword (uae_u16 *mbuf, int shift)
 static uae_u8 mfmdecode (uae_u16 **mfmp, int shift)
 {
 	uae_u16 mfm = getmfmword (*mfmp, shift);
-	uae_u8 out = 0;
-	int i;
 
 	(*mfmp)++;
-	mfm &= 0x5555;
-	for (i = 0; i < 8; i++) {
-		out >>= 1;
-		if (mfm & 1)
-			out |= 0x80;
-		mfm >>= 2;
-	}
-	return out;
+	return mfm_decode_byte (mfm);
 }
 
 static int drive_write_adf_pc (uae_u16 *mbuf, uae_u16 *mend, uae_u8 *writebuffer, uae_u8 *writebuffer_ok, int track, int *outsecs)
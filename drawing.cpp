@@ -123,6 +123,13 @@ struct spritepixelsbuf {
 };
 static struct spritepixelsbuf spritepixels[MAX_PIXELS_PER_LINE];
 static int sprite_first_x, sprite_last_x;
+/* sorted, non-overlapping ranges of spritepixels used by this line */
+#define MAX_SPRITE_SPANS 8
+struct sprite_span {
+	int start, end;
+};
+static struct sprite_span sprite_spans[MAX_SPRITE_SPANS];
+static int sprite_span_cnt;
 
 #ifdef AGA
 /* AGA mode color lookup tables */
@@ -903,6 +910,7 @@ static void pfield_init_linetoscr (bool border)
 
 	sprite_last_x = 0;
 	sprite_first_x = MAX_PIXELS_PER_LINE - 1;
+	sprite_span_cnt = 0;
 
 	/* Now, compute some offsets.  */
 	ddf_left -= DISPLAY_LEFT_SHIFT;
@@ -1423,11 +1431,10 @@ static int NOINLINE linetoscr_16_shrink2f_sh (int spix, int dpix, int stoppos, i
 }
 #endif
 
-static void pfield_do_linetoscr (int start, int stop, bool blank)
+static void pfield_do_linetoscr_1 (int start, int stop, bool spr)
 {
-	xlinecheck(start, stop);
 #ifdef AGA
-	if (issprites && (currprefs.chipset_mask & CSMASK_AGA)) {
+	if (spr && (currprefs.chipset_mask & CSMASK_AGA)) {
 		if (res_shift == 0) {
 			switch (gfxvidinfo.drawbuffer.pixbytes) {
 			case 2: src_pixel = linetoscr_16_aga_spr (LTPARMS); break;
@@ -1516,37 +1523,37 @@ static void pfield_do_linetoscr (int start, int stop, bool blank)
 			if (ecsshres) {
 				if (res_shift == 0) {
 					switch (gfxvidinfo.drawbuffer.pixbytes) {
-					case 2: src_pixel = linetoscr_16_sh (LTPARMS, issprites); break;
-					case 4: src_pixel = linetoscr_32_sh (LTPARMS, issprites); break;
+					case 2: src_pixel = linetoscr_16_sh (LTPARMS, spr); break;
+					case 4: src_pixel = linetoscr_32_sh (LTPARMS, spr); break;
 					}
 				} else if (res_shift == -1) {
 					if (currprefs.gfx_lores_mode) {
 						switch (gfxvidinfo.drawbuffer.pixbytes) {
-						case 2: src_pixel = linetoscr_16_shrink1f_sh (LTPARMS, issprites); break;
-						case 4: src_pixel = linetoscr_32_shrink1f_sh (LTPARMS, issprites); break;
+						case 2: src_pixel = linetoscr_16_shrink1f_sh (LTPARMS, spr); break;
+						case 4: src_pixel = linetoscr_32_shrink1f_sh (LTPARMS, spr); break;
 						}
 					} else {
 						switch (gfxvidinfo.drawbuffer.pixbytes) {
-						case 2: src_pixel = linetoscr_16_shrink1_sh (LTPARMS, issprites); break;
-						case 4: src_pixel = linetoscr_32_shrink1_sh (LTPARMS, issprites); break;
+						case 2: src_pixel = linetoscr_16_shrink1_sh (LTPARMS, spr); break;
+						case 4: src_pixel = linetoscr_32_shrink1_sh (LTPARMS, spr); break;
 						}
 					}
 				} else if (res_shift == -2) {
 					if (currprefs.gfx_lores_mode) {
 						switch (gfxvidinfo.drawbuffer.pixbytes) {
-						case 2: src_pixel = linetoscr_16_shrink2f_sh (LTPARMS, issprites); break;
-						case 4: src_pixel = linetoscr_32_shrink2f_sh (LTPARMS, issprites); break;
+						case 2: src_pixel = linetoscr_16_shrink2f_sh (LTPARMS, spr); break;
+						case 4: src_pixel = linetoscr_32_shrink2f_sh (LTPARMS, spr); break;
 						}
 					} else {
 						switch (gfxvidinfo.drawbuffer.pixbytes) {
-						case 2: src_pixel = linetoscr_16_shrink2_sh (LTPARMS, issprites); break;
-						case 4: src_pixel = linetoscr_32_shrink2_sh (LTPARMS, issprites); break;
+						case 2: src_pixel = linetoscr_16_shrink2_sh (LTPARMS, spr); break;
+						case 4: src_pixel = linetoscr_32_shrink2_sh (LTPARMS, spr); break;
 						}
 					}
 				}
 			} else
 #endif
-				if (issprites) {
+				if (spr) {
 					if (res_shift == 0) {
 						switch (gfxvidinfo.drawbuffer.pixbytes) {
 						case 2: src_pixel = linetoscr_16_spr (LTPARMS); break;
@@ -1608,6 +1615,40 @@ static void pfield_do_linetoscr (int start, int stop, bool blank)
 
 }
 
+static void pfield_do_linetoscr (int start, int stop, bool blank)
+{
+	int unit = res_shift > 0 ? 1 << res_shift : 1;
+	int pos = start;
+
+	xlinecheck(start, stop);
+	if (!issprites) {
+		pfield_do_linetoscr_1 (start, stop, false);
+		return;
+	}
+	/* Only sprite spans need the per pixel sprite merge, keep the start
+	 * of each span aligned to whole source pixels. */
+	for (int i = 0; i < sprite_span_cnt && pos < stop; i++) {
+		int s = sprite_spans[i].start;
+		int e = sprite_spans[i].end;
+		if (e <= pos)
+			continue;
+		if (s < pos)
+			s = pos;
+		s = pos + ((s - pos) & ~(unit - 1));
+		if (s >= stop)
+			break;
+		e = pos + ((e - pos + unit - 1) & ~(unit - 1));
+		if (e > stop)
+			e = stop;
+		if (s > pos)
+			pfield_do_linetoscr_1 (pos, s, false);
+		pfield_do_linetoscr_1 (s, e, true);
+		pos = e;
+	}
+	if (pos < stop)
+		pfield_do_linetoscr_1 (pos, stop, false);
+}
+
 // left or right AGA border sprite
 static void pfield_do_linetoscr_bordersprite_aga (int start, int stop, bool blank)
 {
@@ -1665,6 +1706,131 @@ static void dummy_worker (int start, int stop, bool blank)
 static int ham_decode_pixel;
 static unsigned int ham_lastcolor;
 
+/* HAM pixel as a table: new = (last & mask) | val | (palette[pal] & sel).
+ * Modify pixels have sel = 0, set color pixels have mask = val = 0.
+ */
+#define HAM_OCS6 0
+#define HAM_AGA6 1
+#define HAM_AGA8 2
+static uae_u32 ham_mask[256], ham_val[256], ham_sel[256];
+static uae_u8 ham_pal[256];
+static int ham_table_mode = -1;
+
+static void init_ham_table (int mode)
+{
+	if (ham_table_mode == mode)
+		return;
+	ham_table_mode = mode;
+	for (int pv = 0; pv < 256; pv++) {
+		uae_u32 mask = 0, val = 0;
+		int pal = 0;
+		if (mode == HAM_AGA8) {
+			switch (pv & 0x3)
+			{
+			case 0x0: pal = pv >> 2; break;
+			case 0x1: mask = 0xFFFF03; val = (pv & 0xFC); break;
+			case 0x2: mask = 0x03FFFF; val = (pv & 0xFC) << 16; break;
+			case 0x3: mask = 0xFF03FF; val = (pv & 0xFC) << 8; break;
+			}
+		} else if (mode == HAM_AGA6) {
+			switch (pv & 0x30)
+			{
+			case 0x00: pal = pv; break;
+			case 0x10: mask = 0xFFFF00; val = (pv & 0xF) << 4; break;
+			case 0x20: mask = 0x00FFFF; val = (pv & 0xF) << 20; break;
+			case 0x30: mask = 0xFF00FF; val = (pv & 0xF) << 12; break;
+			}
+		} else {
+			switch (pv & 0x30)
+			{
+			case 0x00: pal = pv & 0x0F; break;
+			case 0x10: mask = 0xFF0; val = (pv & 0xF); break;
+			case 0x20: mask = 0x0FF; val = (pv & 0xF) << 8; break;
+			case 0x30: mask = 0xF0F; val = (pv & 0xF) << 4; break;
+			}
+		}
+		ham_mask[pv] = mask;
+		ham_val[pv] = val;
+		ham_pal[pv] = pal;
+		ham_sel[pv] = (mask | val) ? 0 : 0xFFFFFFFF;
+	}
+}
+
+/* Branch free HAM decode of CNT pixels from ham_decode_pixel, STORE is constant */
+STATIC_INLINE void ham_decode_run (int cnt, bool store)
+{
+	uae_u8 *src = pixdata.apixels + ham_decode_pixel;
+	uae_u32 *dst = ham_linebuf + ham_decode_pixel;
+	uae_u32 last = ham_lastcolor;
+
+	if (cnt <= 0)
+		return;
+	ham_decode_pixel += cnt;
+#ifdef AGA
+	if (ham_table_mode != HAM_OCS6) {
+		const uae_u32 *pal = colors_for_drawing.color_regs_aga;
+		uae_u8 xor_val = bplxor;
+		while (cnt-- > 0) {
+			int pv = *src++ ^ xor_val;
+			last = (last & ham_mask[pv]) | ham_val[pv] | (pal[ham_pal[pv]] & ham_sel[pv]);
+			if (store)
+				*dst++ = last;
+		}
+	} else
+#endif
+	{
+		const uae_u16 *pal = colors_for_drawing.color_regs_ecs;
+		while (cnt-- > 0) {
+			int pv = *src++;
+			last = (last & ham_mask[pv]) | ham_val[pv] | (pal[ham_pal[pv]] & ham_sel[pv]);
+			if (store)
+				*dst++ = last;
+		}
+	}
+	ham_lastcolor = last;
+}
+
+/* Old per pixel HAM decoder, reference for the HAM self test */
+static void ham_decode_ref (int mode, int cnt, bool store)
+{
+	while (cnt-- > 0) {
+		int pv = pixdata.apixels[ham_decode_pixel];
+#ifdef AGA
+		if (mode == HAM_AGA8) {
+			pv ^= bplxor;
+			switch (pv & 0x3)
+			{
+			case 0x0: ham_lastcolor = colors_for_drawing.color_regs_aga[pv >> 2]; break;
+			case 0x1: ham_lastcolor &= 0xFFFF03; ham_lastcolor |= (pv & 0xFC); break;
+			case 0x2: ham_lastcolor &= 0x03FFFF; ham_lastcolor |= (pv & 0xFC) << 16; break;
+			case 0x3: ham_lastcolor &= 0xFF03FF; ham_lastcolor |= (pv & 0xFC) << 8; break;
+			}
+		} else if (mode == HAM_AGA6) {
+			pv ^= bplxor;
+			switch (pv & 0x30)
+			{
+			case 0x00: ham_lastcolor = colors_for_drawing.color_regs_aga[pv]; break;
+			case 0x10: ham_lastcolor &= 0xFFFF00; ham_lastcolor |= (pv & 0xF) << 4; break;
+			case 0x20: ham_lastcolor &= 0x00FFFF; ham_lastcolor |= (pv & 0xF) << 20; break;
+			case 0x30: ham_lastcolor &= 0xFF00FF; ham_lastcolor |= (pv & 0xF) << 12; break;
+			}
+		} else
+#endif
+		{
+			switch (pv & 0x30)
+			{
+			case 0x00: ham_lastcolor = colors_for_drawing.color_regs_ecs[pv]; break;
+			case 0x10: ham_lastcolor &= 0xFF0; ham_lastcolor |= (pv & 0xF); break;
+			case 0x20: ham_lastcolor &= 0x0FF; ham_lastcolor |= (pv & 0xF) << 8; break;
+			case 0x30: ham_lastcolor &= 0xF0F; ham_lastcolor |= (pv & 0xF) << 4; break;
+			}
+		}
+		if (store)
+			ham_linebuf[ham_decode_pixel] = ham_lastcolor;
+		ham_decode_pixel++;
+	}
+}
+
 /* Decode HAM in the invisible portion of the display (left of VISIBLE_LEFT_BORDER),
  * but don't draw anything in.  This is done to prepare HAM_LASTCOLOR for later,
  * when decode_ham runs.
@@ -1687,45 +1853,15 @@ static void init_ham_decoding (void)
 #endif
 				ham_lastcolor = colors_for_drawing.color_regs_ecs[pv];
 		}
+		return;
+	}
 #ifdef AGA
-	} else if (currprefs.chipset_mask & CSMASK_AGA) {
-		if (bplplanecnt >= 7) { /* AGA mode HAM8 */
-			while (unpainted_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel++] ^ bplxor;
-				switch (pv & 0x3)
-				{
-				case 0x0: ham_lastcolor = colors_for_drawing.color_regs_aga[pv >> 2]; break;
-				case 0x1: ham_lastcolor &= 0xFFFF03; ham_lastcolor |= (pv & 0xFC); break;
-				case 0x2: ham_lastcolor &= 0x03FFFF; ham_lastcolor |= (pv & 0xFC) << 16; break;
-				case 0x3: ham_lastcolor &= 0xFF03FF; ham_lastcolor |= (pv & 0xFC) << 8; break;
-				}
-			}
-		} else { /* AGA mode HAM6 */
-			while (unpainted_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel++] ^ bplxor;
-				switch (pv & 0x30)
-				{
-				case 0x00: ham_lastcolor = colors_for_drawing.color_regs_aga[pv]; break;
-				case 0x10: ham_lastcolor &= 0xFFFF00; ham_lastcolor |= (pv & 0xF) << 4; break;
-				case 0x20: ham_lastcolor &= 0x00FFFF; ham_lastcolor |= (pv & 0xF) << 20; break;
-				case 0x30: ham_lastcolor &= 0xFF00FF; ham_lastcolor |= (pv & 0xF) << 12; break;
-				}
-			}
-		}
+	if (currprefs.chipset_mask & CSMASK_AGA)
+		init_ham_table (bplplanecnt >= 7 ? HAM_AGA8 : HAM_AGA6);
+	else
 #endif
-	} else {
-		/* OCS/ECS mode HAM6 */
-		while (unpainted_amiga-- > 0) {
-			int pv = pixdata.apixels[ham_decode_pixel++];
-			switch (pv & 0x30)
-			{
-			case 0x00: ham_lastcolor = colors_for_drawing.color_regs_ecs[pv]; break;
-			case 0x10: ham_lastcolor &= 0xFF0; ham_lastcolor |= (pv & 0xF); break;
-			case 0x20: ham_lastcolor &= 0x0FF; ham_lastcolor |= (pv & 0xF) << 8; break;
-			case 0x30: ham_lastcolor &= 0xF0F; ham_lastcolor |= (pv & 0xF) << 4; break;
-			}
-		}
-	}
+		init_ham_table (HAM_OCS6);
+	ham_decode_run (unpainted_amiga, false);
 }
 
 static void decode_ham (int pix, int stoppos, bool blank)
@@ -1744,48 +1880,16 @@ static void decode_ham (int pix, int stoppos, bool blank)
 
 			ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
 		}
+		return;
+	}
+	// HAM can be switched on mid line
 #ifdef AGA
-	} else if (currprefs.chipset_mask & CSMASK_AGA) {
-		if (bplplanecnt >= 7) { /* AGA mode HAM8 */
-			while (todraw_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel] ^ bplxor;
-				switch (pv & 0x3)
-				{
-				case 0x0: ham_lastcolor = colors_for_drawing.color_regs_aga[pv >> 2]; break;
-				case 0x1: ham_lastcolor &= 0xFFFF03; ham_lastcolor |= (pv & 0xFC); break;
-				case 0x2: ham_lastcolor &= 0x03FFFF; ham_lastcolor |= (pv & 0xFC) << 16; break;
-				case 0x3: ham_lastcolor &= 0xFF03FF; ham_lastcolor |= (pv & 0xFC) << 8; break;
-				}
-				ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-			}
-		} else { /* AGA mode HAM6 */
-			while (todraw_amiga-- > 0) {
-				int pv = pixdata.apixels[ham_decode_pixel] ^ bplxor;
-				switch (pv & 0x30)
-				{
-				case 0x00: ham_lastcolor = colors_for_drawing.color_regs_aga[pv]; break;
-				case 0x10: ham_lastcolor &= 0xFFFF00; ham_lastcolor |= (pv & 0xF) << 4; break;
-				case 0x20: ham_lastcolor &= 0x00FFFF; ham_lastcolor |= (pv & 0xF) << 20; break;
-				case 0x30: ham_lastcolor &= 0xFF00FF; ham_lastcolor |= (pv & 0xF) << 12; break;
-				}
-				ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-			}
-		}
+	if (currprefs.chipset_mask & CSMASK_AGA)
+		init_ham_table (bplplanecnt >= 7 ? HAM_AGA8 : HAM_AGA6);
+	else
 #endif
-	} else {
-		/* OCS/ECS mode HAM6 */
-		while (todraw_amiga-- > 0) {
-			int pv = pixdata.apixels[ham_decode_pixel];
-			switch (pv & 0x30)
-			{
-			case 0x00: ham_lastcolor = colors_for_drawing.color_regs_ecs[pv]; break;
-			case 0x10: ham_lastcolor &= 0xFF0; ham_lastcolor |= (pv & 0xF); break;
-			case 0x20: ham_lastcolor &= 0x0FF; ham_lastcolor |= (pv & 0xF) << 8; break;
-			case 0x30: ham_lastcolor &= 0xF0F; ham_lastcolor |= (pv & 0xF) << 4; break;
-			}
-			ham_linebuf[ham_decode_pixel++] = ham_lastcolor;
-		}
-	}
+		init_ham_table (HAM_OCS6);
+	ham_decode_run (todraw_amiga, true);
 }
 
 static void erase_ham_right_border(int pix, int stoppos, bool blank)
@@ -1799,6 +1903,139 @@ static void erase_ham_right_border(int pix, int stoppos, bool blank)
 		ham_linebuf[ham_decode_pixel++] = 0;
 }
 
+/* HAM self test. The table decoder and the old per pixel decoder run the
+ * same left border replay and the same chain of decode_ham() sized runs,
+ * ham_lastcolor carries from run to run. Odd passes use the captured
+ * current line, palette and BPLCON4, even passes random ones.
+ */
+#define HAMTEST_MAXERRORS 10
+
+struct hamtest_result
+{
+	uae_u32 last;
+	int pixel;
+};
+
+static void hamtest_run (int mode, bool table, int start, uae_u32 first, int border, const int *runs, int nruns, struct hamtest_result *r)
+{
+	ham_decode_pixel = start;
+	ham_lastcolor = first;
+	if (table) {
+		init_ham_table (mode);
+		ham_decode_run (border, false);
+		for (int i = 0; i < nruns; i++)
+			ham_decode_run (runs[i], true);
+	} else {
+		ham_decode_ref (mode, border, false);
+		for (int i = 0; i < nruns; i++)
+			ham_decode_ref (mode, runs[i], true);
+	}
+	r->last = ham_lastcolor;
+	r->pixel = ham_decode_pixel;
+}
+
+void drawing_ham_selftest (int loops, uae_u32 seed)
+{
+	static const TCHAR *modenames[] = { _T("OCS HAM6"), _T("AGA HAM6"), _T("AGA HAM8") };
+	struct color_entry *savecolors;
+	uae_u8 *saveapixels;
+	uae_u32 *savelinebuf, *outbuf[2];
+	int savexor = bplxor, savepixel = ham_decode_pixel, savemode = ham_table_mode;
+	unsigned int savelast = ham_lastcolor;
+	uae_u32 saverand = uaerandgetseed ();
+	int tested = 0, errors = 0;
+#ifdef AGA
+	int modes = 3;
+#else
+	int modes = 1;
+#endif
+
+	if (loops <= 0)
+		loops = 1000;
+	savecolors = xmalloc (struct color_entry, 1);
+	saveapixels = xmalloc (uae_u8, sizeof pixdata.apixels);
+	savelinebuf = xmalloc (uae_u32, MAX_PIXELS_PER_LINE * 2);
+	outbuf[0] = xmalloc (uae_u32, MAX_PIXELS_PER_LINE * 2);
+	outbuf[1] = xmalloc (uae_u32, MAX_PIXELS_PER_LINE * 2);
+	*savecolors = colors_for_drawing;
+	memcpy (saveapixels, pixdata.apixels, sizeof pixdata.apixels);
+	memcpy (savelinebuf, ham_linebuf, sizeof ham_linebuf);
+
+	console_out_f (_T("HAM decoder self test, seed %08X, %d lines per mode\n"), seed, loops);
+	uaesrand (seed);
+	for (int mode = 0; mode < modes; mode++) {
+		uae_u32 colormask = mode == HAM_OCS6 ? 0xfff : 0xffffff;
+		for (int l = 0; l < loops; l++) {
+			struct hamtest_result res[2];
+			int runs[8];
+			int nruns = 1 + uaerand () % 8;
+			int start = uaerand () % 64;
+			int border = uaerand () % 64;
+			uae_u32 first = (((uae_u32)uaerand () << 16) | uaerand ()) & colormask;
+
+			if (l & 1) {
+				// OCS has at most six planes
+				for (int i = 0; i < sizeof pixdata.apixels; i++)
+					pixdata.apixels[i] = mode == HAM_OCS6 ? saveapixels[i] & 0x3f : saveapixels[i];
+				colors_for_drawing = *savecolors;
+				bplxor = savexor;
+			} else {
+				for (int i = 0; i < sizeof pixdata.apixels; i++)
+					pixdata.apixels[i] = mode == HAM_OCS6 ? uaerand () & 0x3f : uaerand ();
+				for (int i = 0; i < 32; i++)
+					colors_for_drawing.color_regs_ecs[i] = uaerand () & 0xfff;
+#ifdef AGA
+				for (int i = 0; i < 256; i++)
+					colors_for_drawing.color_regs_aga[i] = (((uae_u32)uaerand () << 16) | uaerand ()) & 0xffffff;
+#endif
+				bplxor = mode == HAM_OCS6 ? 0 : (uaerand () & 1) ? uaerand () & 0xff : 0;
+			}
+			// runs as split by color changes, some empty
+			for (int i = 0; i < nruns; i++)
+				runs[i] = (uaerand () & 7) ? uaerand () % (MAX_PIXELS_PER_LINE / 8) : 0;
+
+			for (int i = 0; i < 2; i++) {
+				memset (ham_linebuf, 0, sizeof ham_linebuf);
+				hamtest_run (mode, i != 0, start, first, border, runs, nruns, &res[i]);
+				memcpy (outbuf[i], ham_linebuf, sizeof ham_linebuf);
+			}
+			tested++;
+
+			if (res[0].last != res[1].last || res[0].pixel != res[1].pixel || memcmp (outbuf[0], outbuf[1], sizeof ham_linebuf)) {
+				errors++;
+				if (errors <= HAMTEST_MAXERRORS) {
+					console_out_f (_T("Mismatch %d: %s %s line, start %d border %d runs %d BPLXOR %02X last %06X %06X end %d %d\n"),
+						errors, modenames[mode], (l & 1) ? _T("captured") : _T("random"), start, border, nruns, bplxor,
+						res[0].last, res[1].last, res[0].pixel, res[1].pixel);
+					for (int i = 0; i < MAX_PIXELS_PER_LINE * 2; i++) {
+						if (outbuf[0][i] != outbuf[1][i]) {
+							console_out_f (_T(" Pixel %d (%02X): %06X %06X\n"), i, pixdata.apixels[i], outbuf[0][i], outbuf[1][i]);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	colors_for_drawing = *savecolors;
+	memcpy (pixdata.apixels, saveapixels, sizeof pixdata.apixels);
+	memcpy (ham_linebuf, savelinebuf, sizeof ham_linebuf);
+	bplxor = savexor;
+	ham_decode_pixel = savepixel;
+	ham_lastcolor = savelast;
+	if (savemode >= 0)
+		init_ham_table (savemode);
+	xfree (outbuf[1]);
+	xfree (outbuf[0]);
+	xfree (savelinebuf);
+	xfree (saveapixels);
+	xfree (savecolors);
+	uaesrand (saverand);
+
+	console_out_f (_T("%d lines tested, %d mismatches.\n"), tested, errors);
+}
+
 static void gen_pfield_tables (void)
 {
 	int i;
@@ -1847,6 +2084,172 @@ static void gen_pfield_tables (void)
 
 }
 
+static void add_sprite_span (int start, int end)
+{
+	struct sprite_span *sp = sprite_spans;
+	int i, j;
+
+	if (start < 0)
+		start = 0;
+	if (end > MAX_PIXELS_PER_LINE)
+		end = MAX_PIXELS_PER_LINE;
+	if (start >= end)
+		return;
+	for (i = 0; i < sprite_span_cnt && sp[i].end < start; i++);
+	if (i == sprite_span_cnt || sp[i].start > end) {
+		if (sprite_span_cnt < MAX_SPRITE_SPANS) {
+			for (j = sprite_span_cnt; j > i; j--)
+				sp[j] = sp[j - 1];
+			sp[i].start = start;
+			sp[i].end = end;
+			sprite_span_cnt++;
+			return;
+		}
+		// table full, widen the neighbour instead
+		if (i == sprite_span_cnt)
+			i--;
+	}
+	if (start < sp[i].start)
+		sp[i].start = start;
+	if (end > sp[i].end)
+		sp[i].end = end;
+	// absorb following spans that now overlap
+	while (i + 1 < sprite_span_cnt && sp[i + 1].start <= sp[i].end) {
+		if (sp[i + 1].end > sp[i].end)
+			sp[i].end = sp[i + 1].end;
+		for (j = i + 1; j < sprite_span_cnt - 1; j++)
+			sp[j] = sp[j + 1];
+		sprite_span_cnt--;
+	}
+}
+
+/* Sprite span self test. Random sprites are added over the current line
+ * contents, the span list must stay sorted and disjoint and cover every
+ * sprite pixel. The split pfield_do_linetoscr() output must match the
+ * sprite converter run over the whole range.
+ */
+#define SPANTEST_MAXERRORS 10
+
+void drawing_sprite_span_selftest (int loops, uae_u32 seed)
+{
+	int pixbytes = gfxvidinfo.drawbuffer.pixbytes;
+	struct spritepixelsbuf *savepixels;
+	struct sprite_span savespans[MAX_SPRITE_SPANS];
+	int savespancnt = sprite_span_cnt, savesrc = src_pixel;
+	bool savesprites = issprites;
+	uae_u8 *savebuf = xlinebuffer;
+	uae_u8 *covered, *outbuf[2];
+	uae_u32 saverand = uaerandgetseed ();
+	int unit = res_shift > 0 ? 1 << res_shift : 1;
+	int tested = 0, spans = 0, errors = 0;
+
+	if (pixbytes != 2 && pixbytes != 4) {
+		console_out (_T("Sprite span self test needs a 16 or 32-bit display.\n"));
+		return;
+	}
+	if (loops <= 0)
+		loops = 10000;
+	savepixels = xmalloc (struct spritepixelsbuf, MAX_PIXELS_PER_LINE);
+	covered = xmalloc (uae_u8, MAX_PIXELS_PER_LINE);
+	outbuf[0] = xmalloc (uae_u8, MAX_PIXELS_PER_LINE * 4);
+	outbuf[1] = xmalloc (uae_u8, MAX_PIXELS_PER_LINE * 4);
+	memcpy (savepixels, spritepixels, sizeof spritepixels);
+	memcpy (savespans, sprite_spans, sizeof sprite_spans);
+
+	console_out_f (_T("Sprite span self test, seed %08X, %d lines\n"), seed, loops);
+	uaesrand (seed);
+	issprites = true;
+	for (int l = 0; l < loops; l++) {
+		// playfield pixels are the current line contents, only sprites are random
+		int len = unit + (uaerand () % (MAX_PIXELS_PER_LINE / 4)) / unit * unit;
+		int start = (uaerand () % (MAX_PIXELS_PER_LINE - len)) / unit * unit;
+		int stop = start + len;
+		int src = uaerand () % (MAX_PIXELS_PER_LINE / 2);
+		int nspr = uaerand () % 12;
+		int endsrc[2];
+		bool bad = false;
+
+		memset (spritepixels, 0, sizeof spritepixels);
+		memset (covered, 0, MAX_PIXELS_PER_LINE);
+		sprite_span_cnt = 0;
+		for (int i = 0; i < nspr; i++) {
+			int s = start - 64 + (int)(uaerand () % (len + 128));
+			int e = s + 1 + uaerand () % 64;
+			add_sprite_span (s, e);
+			if (s < 0)
+				s = 0;
+			if (e > MAX_PIXELS_PER_LINE)
+				e = MAX_PIXELS_PER_LINE;
+			for (int x = s; x < e; x++) {
+				covered[x] = 1;
+				// transparent sprite pixels are not recorded
+				if (uaerand () & 7) {
+					spritepixels[x].data = uaerand ();
+					spritepixels[x].stdata = uaerand ();
+					spritepixels[x].attach = uaerand () & 1;
+				}
+			}
+		}
+		spans += sprite_span_cnt;
+
+		if (sprite_span_cnt > MAX_SPRITE_SPANS)
+			bad = true;
+		for (int i = 0; i < sprite_span_cnt && !bad; i++) {
+			if (sprite_spans[i].start >= sprite_spans[i].end)
+				bad = true;
+			if (i > 0 && sprite_spans[i - 1].end >= sprite_spans[i].start)
+				bad = true;
+			for (int x = sprite_spans[i].start; x < sprite_spans[i].end && !bad; x++)
+				covered[x] = 0;
+		}
+		for (int x = 0; x < MAX_PIXELS_PER_LINE && !bad; x++) {
+			if (covered[x])
+				bad = true;
+		}
+
+		if (!bad) {
+			for (int i = 0; i < 2; i++) {
+				memset (outbuf[i], 0, MAX_PIXELS_PER_LINE * 4);
+				xlinebuffer = outbuf[i];
+				src_pixel = src;
+				if (i)
+					pfield_do_linetoscr (start, stop, false);
+				else
+					pfield_do_linetoscr_1 (start, stop, true);
+				endsrc[i] = src_pixel;
+			}
+			if (endsrc[0] != endsrc[1] || memcmp (outbuf[0], outbuf[1], MAX_PIXELS_PER_LINE * pixbytes))
+				bad = true;
+		}
+		tested++;
+
+		if (bad) {
+			errors++;
+			if (errors <= SPANTEST_MAXERRORS) {
+				console_out_f (_T("Mismatch %d: pixels %d-%d source %d, %d sprites, %d spans:"),
+					errors, start, stop, src, nspr, sprite_span_cnt);
+				for (int i = 0; i < sprite_span_cnt && i < MAX_SPRITE_SPANS; i++)
+					console_out_f (_T(" %d-%d"), sprite_spans[i].start, sprite_spans[i].end);
+				console_out_f (_T("\n"));
+			}
+		}
+	}
+
+	memcpy (spritepixels, savepixels, sizeof spritepixels);
+	memcpy (sprite_spans, savespans, sizeof sprite_spans);
+	sprite_span_cnt = savespancnt;
+	src_pixel = savesrc;
+	issprites = savesprites;
+	xlinebuffer = savebuf;
+	xfree (outbuf[1]);
+	xfree (outbuf[0]);
+	xfree (covered);
+	xfree (savepixels);
+	uaesrand (saverand);
+
+	console_out_f (_T("%d lines tested, %d spans, %d mismatches.\n"), tested, spans, errors);
+}
+
 /* When looking at this function and the ones that inline it, bear in mind
 what an optimizing compiler will do with this code.  All callers of this
 function only pass in constant arguments (except for E).  This means
@@ -1875,6 +2278,8 @@ STATIC_INLINE void draw_sprites_1 (struct sprite_entry *e, int dualpf, int has_a
 
 	if (spr_pos > sprite_last_x)
 		sprite_last_x = spr_pos;
+
+	add_sprite_span (spr_pos - (e->max - e->pos), spr_pos);
 }
 
 /* See comments above.  Do not touch if you don't know what's going on.
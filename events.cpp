@@ -31,6 +31,25 @@ frame_time_t vsyncmintime, vsyncmaxtime, vsyncwaittime;
 int vsynctimebase;
 int event2_count;
 
+/* eventtab2[] grows on demand, pending entries are kept in a binary
+ * heap ordered by time from now (slot number breaks ties, same order
+ * the old linear scan used). */
+#define EV2_INITIAL 16
+static struct ev2 eventtab2_static[EV2_INITIAL];
+static int ev2_heap_static[EV2_INITIAL];
+struct ev2 *eventtab2 = eventtab2_static;
+int ev2_max = EV2_INITIAL;
+static int *ev2_heap = ev2_heap_static;
+static int ev2_heap_cnt;
+
+#define EV2_STATS 32
+static uae_u32 ev_dispatched[ev_max];
+static struct ev2stat
+{
+	evfunc2 handler;
+	uae_u32 count;
+} ev2_stats[EV2_STATS];
+
 void events_schedule (void)
 {
 	int i;
@@ -114,6 +133,7 @@ void do_cycles_slow (unsigned long cycles_to_add)
 					gui_message(_T("eventtab[%d].handler is null!\n"), i);
 					eventtab[i].active = 0;
 				} else {
+					ev_dispatched[i]++;
 					(*eventtab[i].handler)();
 				}
 			}
@@ -125,47 +145,148 @@ void do_cycles_slow (unsigned long cycles_to_add)
 	currcycle += cycles_to_add;
 }
 
+STATIC_INLINE bool ev2_before (int a, int b, evt ct)
+{
+	evt ta = eventtab2[a].evtime - ct;
+	evt tb = eventtab2[b].evtime - ct;
+	return ta < tb || (ta == tb && a < b);
+}
+
+STATIC_INLINE void ev2_heap_set (int pos, int no)
+{
+	ev2_heap[pos] = no;
+	eventtab2[no].heap = pos + 1;
+}
+
+static void ev2_sift_up (int pos, evt ct)
+{
+	int no = ev2_heap[pos];
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (!ev2_before (no, ev2_heap[parent], ct))
+			break;
+		ev2_heap_set (pos, ev2_heap[parent]);
+		pos = parent;
+	}
+	ev2_heap_set (pos, no);
+}
+
+static void ev2_sift_down (int pos, evt ct)
+{
+	int no = ev2_heap[pos];
+	for (;;) {
+		int c = pos * 2 + 1;
+		if (c >= ev2_heap_cnt)
+			break;
+		if (c + 1 < ev2_heap_cnt && ev2_before (ev2_heap[c + 1], ev2_heap[c], ct))
+			c++;
+		if (!ev2_before (ev2_heap[c], no, ct))
+			break;
+		ev2_heap_set (pos, ev2_heap[c]);
+		pos = c;
+	}
+	ev2_heap_set (pos, no);
+}
+
+static void ev2_queue (int no, evt ct)
+{
+	int pos = eventtab2[no].heap - 1;
+	if (pos < 0) {
+		pos = ev2_heap_cnt++;
+		ev2_heap_set (pos, no);
+	}
+	ev2_sift_up (pos, ct);
+	ev2_sift_down (eventtab2[no].heap - 1, ct);
+}
+
+static void ev2_unqueue (int no, evt ct)
+{
+	int pos = eventtab2[no].heap - 1;
+	if (pos < 0)
+		return;
+	eventtab2[no].heap = 0;
+	ev2_heap_cnt--;
+	if (pos < ev2_heap_cnt) {
+		int last = ev2_heap[ev2_heap_cnt];
+		ev2_heap_set (pos, last);
+		ev2_sift_up (pos, ct);
+		ev2_sift_down (eventtab2[last].heap - 1, ct);
+	}
+}
+
+static int ev2_grow (void)
+{
+	int size = ev2_max * 2;
+	struct ev2 *tab = xcalloc (struct ev2, size);
+	int *heap = xmalloc (int, size);
+	int no = ev2_max;
+
+	if (!tab || !heap) {
+		xfree (tab);
+		xfree (heap);
+		return -1;
+	}
+	memcpy (tab, eventtab2, ev2_max * sizeof (struct ev2));
+	memcpy (heap, ev2_heap, ev2_heap_cnt * sizeof (int));
+	if (eventtab2 != eventtab2_static)
+		xfree (eventtab2);
+	if (ev2_heap != ev2_heap_static)
+		xfree (ev2_heap);
+	eventtab2 = tab;
+	ev2_heap = heap;
+	ev2_max = size;
+	write_log (_T("event2 table grown to %d entries\n"), size);
+	return no;
+}
+
+static void ev2_count_dispatch (evfunc2 handler)
+{
+	for (int i = 0; i < EV2_STATS; i++) {
+		if (ev2_stats[i].handler == handler || !ev2_stats[i].handler) {
+			ev2_stats[i].handler = handler;
+			ev2_stats[i].count++;
+			return;
+		}
+	}
+}
+
+void init_eventtab2 (void)
+{
+	for (int i = 0; i < ev2_max; i++) {
+		eventtab2[i].active = 0;
+		eventtab2[i].heap = 0;
+	}
+	ev2_heap_cnt = 0;
+}
+
+void event2_remevent (int no)
+{
+	eventtab2[no].active = 0;
+	ev2_unqueue (no, get_cycles ());
+}
+
 void MISC_handler (void)
 {
-	static bool dorecheck;
-	bool recheck;
-	int i;
-	evt mintime;
-	evt ct = get_cycles ();
 	static int recursive;
+	evt ct = get_cycles ();
 
-	if (recursive) {
-		dorecheck = true;
+	if (recursive)
 		return;
-	}
 	recursive++;
 	eventtab[ev_misc].active = 0;
-	recheck = true;
-	while (recheck) {
-		recheck = false;
-		mintime = ~0L;
-		for (i = 0; i < ev2_max; i++) {
-			if (eventtab2[i].active) {
-				if (eventtab2[i].evtime == ct) {
-					eventtab2[i].active = false;
-					event2_count--;
-					eventtab2[i].handler (eventtab2[i].data);
-					if (dorecheck || eventtab2[i].active) {
-						recheck = true;
-						dorecheck = false;
-					}
-				} else {
-					evt eventtime = eventtab2[i].evtime - ct;
-					if (eventtime < mintime)
-						mintime = eventtime;
-				}
-			}
-		}
+	// handlers can add events, always look at the current head
+	while (ev2_heap_cnt > 0 && eventtab2[ev2_heap[0]].evtime == ct) {
+		int no = ev2_heap[0];
+		ev2_unqueue (no, ct);
+		eventtab2[no].active = false;
+		event2_count--;
+		ev2_count_dispatch (eventtab2[no].handler);
+		eventtab2[no].handler (eventtab2[no].data);
 	}
-	if (mintime != ~0UL) {
+	if (ev2_heap_cnt > 0) {
 		eventtab[ev_misc].active = true;
 		eventtab[ev_misc].oldcycles = ct;
-		eventtab[ev_misc].evtime = ct + mintime;
+		eventtab[ev_misc].evtime = eventtab2[ev2_heap[0]].evtime;
 		events_schedule ();
 	}
 	recursive--;
@@ -191,8 +312,13 @@ void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func)
 			if (no == ev2_max)
 				no = ev2_misc;
 			if (no == next) {
-				write_log (_T("out of event2's!\n"));
-				return;
+				no = ev2_grow ();
+				if (no < 0) {
+					write_log (_T("out of event2's!\n"));
+					return;
+				}
+				event2_count++;
+				break;
 			}
 		}
 		next = no;
@@ -201,9 +327,52 @@ void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func)
 	eventtab2[no].evtime = et;
 	eventtab2[no].handler = func;
 	eventtab2[no].data = data;
+	ev2_queue (no, get_cycles ());
 	MISC_handler ();
 }
 
+void events_reset_stats (void)
+{
+	memset (ev_dispatched, 0, sizeof ev_dispatched);
+	memset (ev2_stats, 0, sizeof ev2_stats);
+}
+
+void events_dump (void)
+{
+	static const TCHAR *evnames[] = { _T("CIA"), _T("Audio"), _T("Misc"), _T("Hsync") };
+	int *order = xmalloc (int, ev2_heap_cnt + 1);
+	evt ct = get_cycles ();
+	int i, j, cnt;
+
+	console_out_f (_T("Cycle %08lx, next event in %ld CCKs\n"), ct, (long)((nextevent - ct) / CYCLE_UNIT));
+	for (i = 0; i < ev_max; i++) {
+		console_out_f (_T(" %-7s %-8s %10ld %10u\n"), evnames[i],
+			eventtab[i].active ? _T("active") : _T("-"),
+			eventtab[i].active ? (long)((eventtab[i].evtime - ct) / CYCLE_UNIT) : 0L,
+			ev_dispatched[i]);
+	}
+	// pending queue in dispatch order
+	cnt = 0;
+	for (i = 0; i < ev2_heap_cnt; i++) {
+		int no = ev2_heap[i];
+		for (j = cnt; j > 0 && ev2_before (no, order[j - 1], ct); j--)
+			order[j] = order[j - 1];
+		order[j] = no;
+		cnt++;
+	}
+	console_out_f (_T("%d/%d event2 slots pending:\n"), ev2_heap_cnt, ev2_max);
+	for (i = 0; i < cnt; i++) {
+		struct ev2 *e = &eventtab2[order[i]];
+		console_out_f (_T(" %3d %p %08x %10ld %s\n"), order[i], e->handler, e->data,
+			(long)((e->evtime - ct) / CYCLE_UNIT),
+			order[i] == ev2_blitter ? _T("Blitter") : (order[i] == ev2_disk ? _T("Disk") : _T("")));
+	}
+	xfree (order);
+	console_out (_T("event2 dispatch counts:\n"));
+	for (i = 0; i < EV2_STATS && ev2_stats[i].handler; i++)
+		console_out_f (_T(" %p %10u\n"), ev2_stats[i].handler, ev2_stats[i].count);
+}
+
 int current_hpos (void)
 {
 	int hp = current_hpos_safe ();
@@ -43,6 +43,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "fdi2raw.h"
 #include "crc32.h"
+#include "diskutil.h"
 
 #undef DEBUG
 #define VERBOSE
@@ -616,7 +617,6 @@ static int amiga_check_track (FDI *fdi)
 	int length = 2 * fwlen;
 	int drvsec = 11;
 	uae_u32 odd, even, chksum, id, dlong;
-	uae_u8 *secdata;
 	uae_u8 secbuf[544];
 	uae_u8 bigmfmbuf[60000];
 	uae_u8 *mbuf, *mbuf2, *mend;
@@ -729,19 +729,8 @@ static int amiga_check_track (FDI *fdi)
 		even = getmfmlong (mbuf + 2 * 2);
 		mbuf += 4 * 2;
 		chksum = (odd << 1) | even;
-		secdata = secbuf + 32;
-		for (i = 0; i < 128; i++) {
-			odd = getmfmlong (mbuf);
-			even = getmfmlong (mbuf + 256 * 2);
-			mbuf += 2 * 2;
-			dlong = (odd << 1) | even;
-			*secdata++ = (uae_u8) (dlong >> 24);
-			*secdata++ = (uae_u8) (dlong >> 16);
-			*secdata++ = (uae_u8) (dlong >> 8);
-			*secdata++ = (uae_u8) dlong;
-			chksum ^= odd ^ even;
-		}
-		mbuf += 256 * 2;
+		chksum ^= mfm_decode_oddeven_b (mbuf, mbuf + 256 * 2, secbuf + 32, 512);
+		mbuf += 512 * 2;
 		if (chksum) {
 			outlog (_T("sector %d data checksum error\n"),trackoffs);
 			ok = 0;
@@ -788,20 +777,7 @@ static void amiga_data (FDI *fdi, uae_u8 *secbuf)
 	uae_u32 dodd, deven, dck;
 	int i;
 
-	for (i = 0; i < 512; i += 4) {
-		deven = ((secbuf[i + 0] << 24) | (secbuf[i + 1] << 16)
-			| (secbuf[i + 2] << 8) | (secbuf[i + 3]));
-		dodd = deven >> 1;
-		deven &= 0x55555555;
-		dodd &= 0x55555555;
-		mfmbuf[(i >> 1) + 4] = (uae_u16) (dodd >> 16);
-		mfmbuf[(i >> 1) + 5] = (uae_u16) dodd;
-		mfmbuf[(i >> 1) + 256 + 4] = (uae_u16) (deven >> 16);
-		mfmbuf[(i >> 1) + 256 + 5] = (uae_u16) deven;
-	}
-	dck = 0;
-	for (i = 4; i < 4 + 512; i += 2)
-		dck ^= (mfmbuf[i] << 16) | mfmbuf[i + 1];
+	dck = mfm_encode_oddeven (secbuf, mfmbuf + 4, mfmbuf + 256 + 4, 512);
 	deven = dodd = dck;
 	dodd >>= 1;
 	deven &= 0x55555555;
@@ -147,12 +147,67 @@ static fptype fsizes[] = { -128.0, 127.0, -32768.0, 32767.0, -2147483648.0, 2147
 #define FP_SNAN (1 << 14)
 #define FP_BSUN (1 << 15)
 
-STATIC_INLINE void MAKE_FPSR (fptype *fp)
-{
+/* Host FPU or softfloat implementations, selected once by fpp_set_funcs().
+ * Until the first FPU reset (the disassembler can get here first) the
+ * softfloat set is used. */
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return;
-#endif
+static void to_single_softfloat(fpdata *fpd, uae_u32 value);
+static uae_u32 from_single_softfloat(fpdata *fpd);
+static void to_double_softfloat(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2);
+static void from_double_softfloat(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2);
+static void to_exten_softfloat(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3);
+static void from_exten_softfloat(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2, uae_u32 *wrd3);
+static bool fp_is_snan_softfloat(fpdata *fpd);
+static bool fp_is_nan_softfloat(fpdata *fpd);
+static bool fp_is_infinity_softfloat(fpdata *fpd);
+static bool fp_is_zero_softfloat(fpdata *fpd);
+static bool fp_is_neg_softfloat(fpdata *fpd);
+static bool fpu_get_constant_softfloat(fpdata *fpd, int cr);
+static void fround_softfloat(int reg);
+static bool arithmetic_softfloat(fpdata *src, int reg, int extra);
+static void make_fpsr_softfloat(fptype *fp);
+static void clear_status_softfloat(void);
+#define FPP_DEFAULT(f) f##_softfloat
+#define FPP_DEFAULT_ARITHMETIC arithmetic_softfloat
+#else
+static void to_single_fp(fpdata *fpd, uae_u32 value);
+static uae_u32 from_single_fp(fpdata *fpd);
+static void to_double_fp(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2);
+static void from_double_fp(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2);
+static void to_exten_fp(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3);
+static void from_exten_fp(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2, uae_u32 *wrd3);
+static bool fp_is_snan_fp(fpdata *fpd);
+static bool fp_is_nan_fp(fpdata *fpd);
+static bool fp_is_infinity_fp(fpdata *fpd);
+static bool fp_is_zero_fp(fpdata *fpd);
+static bool fp_is_neg_fp(fpdata *fpd);
+static bool fpu_get_constant_fp(fpdata *fpd, int cr);
+static void fround_fp(int reg);
+static bool arithmetic_fp_reg(fpdata *src, int reg, int extra);
+static void make_fpsr_fp(fptype *fp);
+static void clear_status_fp(void);
+#define FPP_DEFAULT(f) f##_fp
+#define FPP_DEFAULT_ARITHMETIC arithmetic_fp_reg
+#endif
+static void (*fpp_to_single)(fpdata *fpd, uae_u32 value) = FPP_DEFAULT(to_single);
+static uae_u32 (*fpp_from_single)(fpdata *fpd) = FPP_DEFAULT(from_single);
+static void (*fpp_to_double)(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2) = FPP_DEFAULT(to_double);
+static void (*fpp_from_double)(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2) = FPP_DEFAULT(from_double);
+static void (*fpp_to_exten)(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3) = FPP_DEFAULT(to_exten);
+static void (*fpp_from_exten)(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2, uae_u32 *wrd3) = FPP_DEFAULT(from_exten);
+static bool (*fpp_is_snan)(fpdata *fpd) = FPP_DEFAULT(fp_is_snan);
+static bool (*fpp_is_nan)(fpdata *fpd) = FPP_DEFAULT(fp_is_nan);
+static bool (*fpp_is_infinity)(fpdata *fpd) = FPP_DEFAULT(fp_is_infinity);
+static bool (*fpp_is_zero)(fpdata *fpd) = FPP_DEFAULT(fp_is_zero);
+static bool (*fpp_is_neg)(fpdata *fpd) = FPP_DEFAULT(fp_is_neg);
+static bool (*fpp_get_constant)(fpdata *fpd, int cr) = FPP_DEFAULT(fpu_get_constant);
+static void (*fpp_round_single)(int reg) = FPP_DEFAULT(fround);
+static bool (*fpp_arithmetic)(fpdata *src, int reg, int extra) = FPP_DEFAULT_ARITHMETIC;
+static void (*fpp_make_fpsr)(fptype *fp) = FPP_DEFAULT(make_fpsr);
+static void (*fpp_clear_status)(void) = FPP_DEFAULT(clear_status);
+
+static void make_fpsr_fp (fptype *fp)
+{
 	int status = fetestexcept (FE_ALL_EXCEPT);
 	if (status) {
 		if (status & FE_INEXACT)
@@ -186,13 +241,28 @@ STATIC_INLINE void MAKE_FPSR_SOFTFLOAT(floatx80 fx)
 }
 #endif
 
-STATIC_INLINE void CLEAR_STATUS (void)
+static void clear_status_fp (void)
 {
+	feclearexcept (FE_ALL_EXCEPT);
+}
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return;
+// softfloat keeps its own sticky status in fxstatus
+static void make_fpsr_softfloat (fptype *fp)
+{
+}
+static void clear_status_softfloat (void)
+{
+}
 #endif
-	feclearexcept (FE_ALL_EXCEPT);
+
+STATIC_INLINE void MAKE_FPSR (fptype *fp)
+{
+	fpp_make_fpsr (fp);
+}
+
+STATIC_INLINE void CLEAR_STATUS (void)
+{
+	fpp_clear_status ();
 }
 
 #ifdef WITH_SOFTFLOAT
@@ -232,80 +302,100 @@ static void fpset (fpdata *fpd, uae_s32 val)
 #endif
 }
 
-void to_single(fpdata *fpd, uae_u32 value)
+static void to_single_fp(fpdata *fpd, uae_u32 value)
+{
+	fpd->fp = to_single_x(value);
+}
+static uae_u32 from_single_fp(fpdata *fpd)
+{
+	return from_single_x(fpd->fp);
+}
+static void to_double_fp(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2)
+{
+	fpd->fp = to_double_x(wrd1, wrd2);
+}
+static void from_double_fp(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2)
+{
+	from_double_x(fpd->fp, wrd1, wrd2);
+}
+static void to_exten_fp(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3)
+{
+	to_exten_x(&fpd->fp, wrd1, wrd2, wrd3);
+}
+static void from_exten_fp(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2, uae_u32 *wrd3)
 {
+	from_exten_x(fpd->fp, wrd1, wrd2, wrd3);
+}
+
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float32 f = value;
-		fpd->fpx = float32_to_floatx80(f, fxstatus);
-	} else
+static void to_single_softfloat(fpdata *fpd, uae_u32 value)
+{
+	float32 f = value;
+	fpd->fpx = float32_to_floatx80(f, fxstatus);
+}
+static uae_u32 from_single_softfloat(fpdata *fpd)
+{
+	float32 f = floatx80_to_float32(fpd->fpx, fxstatus);
+	return f;
+}
+static void to_double_softfloat(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2)
+{
+	float64 f = ((float64)wrd1 << 32) | wrd2;
+	fpd->fpx = float64_to_floatx80(f, fxstatus);
+}
+static void from_double_softfloat(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2)
+{
+	float64 f = floatx80_to_float64(fpd->fpx, fxstatus);
+	*wrd1 = f >> 32;
+	*wrd2 = (uae_u32)f;
+}
+static void to_exten_softfloat(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3)
+{
+	fpd->fpx.exp = wrd1 >> 16;
+	fpd->fpx.fraction = ((uae_u64)wrd2 << 32) | wrd3;
+#if 0
+	if ((currprefs.fpu_model == 68881 || currprefs.fpu_model == 68882) || currprefs.fpu_no_unimplemented) {
+		// automatically fix denormals if 6888x or no implemented emulation
+		Bit64u Sig = extractFloatx80Frac(fpd->fpx);
+		Bit32s Exp = extractFloatx80Exp(fpd->fpx);
+		if (Exp == 0 && Sig != 0)
+			normalizeFloatx80Subnormal(Sig, &Exp, &Sig);
+	}
 #endif
-		fpd->fp = to_single_x(value);
 }
-static uae_u32 from_single(fpdata *fpd)
+static void from_exten_softfloat(fpdata *fpd, uae_u32 * wrd1, uae_u32 * wrd2, uae_u32 * wrd3)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float32 f = floatx80_to_float32(fpd->fpx, fxstatus);
-		return f;
-	} else
+	*wrd1 = fpd->fpx.exp << 16;
+	*wrd2 = fpd->fpx.fraction >> 32;
+	*wrd3 = (uae_u32)fpd->fpx.fraction;
+}
 #endif
-		return from_single_x(fpd->fp);
+
+void to_single(fpdata *fpd, uae_u32 value)
+{
+	fpp_to_single(fpd, value);
+}
+static uae_u32 from_single(fpdata *fpd)
+{
+	return fpp_from_single(fpd);
 }
 void to_double(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float64 f = ((float64)wrd1 << 32) | wrd2;
-		fpd->fpx = float64_to_floatx80(f, fxstatus);
-	} else
-#endif
-		fpd->fp = to_double_x(wrd1, wrd2);
+	fpp_to_double(fpd, wrd1, wrd2);
 }
 static void from_double(fpdata *fpd, uae_u32 *wrd1, uae_u32 *wrd2)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float64 f = floatx80_to_float64(fpd->fpx, fxstatus);
-		*wrd1 = f >> 32;
-		*wrd2 = (uae_u32)f;
-		return;
-	} else
-#endif
-		return from_double_x(fpd->fp, wrd1, wrd2);
+	fpp_from_double(fpd, wrd1, wrd2);
 }
 void to_exten(fpdata *fpd, uae_u32 wrd1, uae_u32 wrd2, uae_u32 wrd3)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		fpd->fpx.exp = wrd1 >> 16;
-		fpd->fpx.fraction = ((uae_u64)wrd2 << 32) | wrd3;
-#if 0
-		if ((currprefs.fpu_model == 68881 || currprefs.fpu_model == 68882) || currprefs.fpu_no_unimplemented) {
-			// automatically fix denormals if 6888x or no implemented emulation
-			Bit64u Sig = extractFloatx80Frac(fpd->fpx);
-			Bit32s Exp = extractFloatx80Exp(fpd->fpx);
-			if (Exp == 0 && Sig != 0)
-				normalizeFloatx80Subnormal(Sig, &Exp, &Sig);
-		}
-#endif
-	} else
-#endif
-		to_exten_x(&fpd->fp, wrd1, wrd2, wrd3);
+	fpp_to_exten(fpd, wrd1, wrd2, wrd3);
 }
 static void from_exten(fpdata *fpd, uae_u32 * wrd1, uae_u32 * wrd2, uae_u32 * wrd3)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		*wrd1 = fpd->fpx.exp << 16;
-		*wrd2 = fpd->fpx.fraction >> 32;
-		*wrd3 = (uae_u32)fpd->fpx.fraction;
-	} else
-#endif
-		from_exten_x(fpd->fp, wrd1, wrd2, wrd3);
+	fpp_from_exten(fpd, wrd1, wrd2, wrd3);
 }
 
-
 #if 0
 static void normalize(uae_u32 *pwrd1, uae_u32 *pwrd2, uae_u32 *pwrd3)
 {
@@ -498,11 +588,7 @@ static bool fpu_get_constant_softfloat(fpdata *fp, int cr)
 
 bool fpu_get_constant(fpdata *fp, int cr)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return fpu_get_constant_softfloat(fp, cr);
-#endif
-	return fpu_get_constant_fp(fp, cr);
+	return fpp_get_constant(fp, cr);
 }
 
 static void native_set_fpucw (uae_u32 m68k_cw)
@@ -525,7 +611,7 @@ static void native_set_fpucw (uae_u32 m68k_cw)
 		switch((m68k_cw >> 4) & 3)
 		{
 			case 0: // to neareset
-				fxstatus.float_rounding_precision = float_round_nearest_even;
+				fxstatus.float_rounding_mode = float_round_nearest_even;
 			break;
 			case 1: // to zero
 				fxstatus.float_rounding_mode = float_round_to_zero;
@@ -942,85 +1028,67 @@ static void fpu_null (void)
 #define fp_round_to_zero(x)	((x) >= 0.0 ? floor(x) : ceil(x))
 #define fp_round_to_nearest(x) ((x) >= 0.0 ? (int)((x) + 0.5) : (int)((x) - 0.5))
 
-static tointtype toint(fpdata *src, int size)
-{
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		if (floatx80_compare(src->fpx, fxsizes[size * 2 + 0], fxstatus) == float_relation_greater)
-			return floatx80_to_int32(fxsizes[size * 2 + 0], fxstatus);	
-		if (floatx80_compare(src->fpx, fxsizes[size * 2 + 1], fxstatus) == float_relation_less)
-			return floatx80_to_int32(fxsizes[size * 2 + 1], fxstatus);
-		return floatx80_to_int32(src->fpx, fxstatus);
-	} else
+static tointtype toint_softfloat(fpdata *src, int size);
+#else
+static tointtype toint_fp(fpdata *src, int size);
 #endif
+static tointtype (*fpp_toint)(fpdata *src, int size) = FPP_DEFAULT(toint);
+
+static tointtype toint_fp(fpdata *src, int size)
+{
+	fptype fp = src->fp;
+	if (fp < fsizes[size * 2 + 0])
+		fp = fsizes[size * 2 + 0];
+	if (fp > fsizes[size * 2 + 1])
+		fp = fsizes[size * 2 + 1];
+#if defined(X86_MSVC_ASSEMBLY_FPU)
 	{
-		fptype fp = src->fp;
-		if (fp < fsizes[size * 2 + 0])
-			fp = fsizes[size * 2 + 0];
-		if (fp > fsizes[size * 2 + 1])
-			fp = fsizes[size * 2 + 1];
-	#if defined(X86_MSVC_ASSEMBLY_FPU)
-		{
-			fptype tmp_fp;
-			__asm {
-				fld  LDPTR fp
-				frndint
-				fstp LDPTR tmp_fp
-			}
-			return (tointtype)tmp_fp;
+		fptype tmp_fp;
+		__asm {
+			fld  LDPTR fp
+			frndint
+			fstp LDPTR tmp_fp
 		}
-	#else /* no X86_MSVC */
+		return (tointtype)tmp_fp;
+	}
+#else /* no X86_MSVC */
+	{
+		int result = (int)fp;
+		switch (regs.fpcr & 0x30)
 		{
-			int result = (int)fp;
-			switch (regs.fpcr & 0x30)
-			{
-				case FPCR_ROUND_ZERO:
-					result = (int)fp_round_to_zero (fp);
-					break;
-				case FPCR_ROUND_MINF:
-					result = (int)fp_round_to_minus_infinity (fp);
-					break;
-				case FPCR_ROUND_NEAR:
-					result = fp_round_to_nearest (fp);
-					break;
-				case FPCR_ROUND_PINF:
-					result = (int)fp_round_to_plus_infinity (fp);
-					break;
-			}
-			return result;
+			case FPCR_ROUND_ZERO:
+				result = (int)fp_round_to_zero (fp);
+				break;
+			case FPCR_ROUND_MINF:
+				result = (int)fp_round_to_minus_infinity (fp);
+				break;
+			case FPCR_ROUND_NEAR:
+				result = fp_round_to_nearest (fp);
+				break;
+			case FPCR_ROUND_PINF:
+				result = (int)fp_round_to_plus_infinity (fp);
+				break;
 		}
-	#endif
+		return result;
 	}
+#endif
 }
 
-static bool fp_is_snan(fpdata *fpd)
+static bool fp_is_snan_fp(fpdata *fpd)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return floatx80_is_signaling_nan(fpd->fpx) != 0;
-#endif
 	return false;
 }
-static bool fp_is_nan (fpdata *fpd)
+static bool fp_is_nan_fp (fpdata *fpd)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return floatx80_is_nan(fpd->fpx) != 0;
-#endif
 #ifdef HAVE_ISNAN
 	return isnan(fpd->fp) != 0;
 #else
 	return false;
 #endif
 }
-static bool fp_is_infinity (fpdata *fpd)
+static bool fp_is_infinity_fp (fpdata *fpd)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float_class_t fc = floatx80_class(fpd->fpx);
-		return fc == float_negative_inf || fc == float_positive_inf;
-	}
-#endif
 #ifdef _MSC_VER
 	return !_finite (fpd->fp);
 #elif defined(HAVE_ISINF)
@@ -1029,21 +1097,70 @@ static bool fp_is_infinity (fpdata *fpd)
 	return false;
 #endif
 }
-static bool fp_is_zero(fpdata *fpd)
+static bool fp_is_zero_fp(fpdata *fpd)
 {
-#ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return floatx80_compare_quiet(fpd->fpx, fxzero, fxstatus) == float_relation_equal;
-#endif
 	return fpd->fp == 0.0;
 }
-static bool fp_is_neg(fpdata *fpd)
+static bool fp_is_neg_fp(fpdata *fpd)
 {
+	return fpd->fp < 0.0;
+}
+
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat)
-		return extractFloatx80Sign(fpd->fpx) != 0;
+static tointtype toint_softfloat(fpdata *src, int size)
+{
+	if (floatx80_compare(src->fpx, fxsizes[size * 2 + 0], fxstatus) == float_relation_greater)
+		return floatx80_to_int32(fxsizes[size * 2 + 0], fxstatus);	
+	if (floatx80_compare(src->fpx, fxsizes[size * 2 + 1], fxstatus) == float_relation_less)
+		return floatx80_to_int32(fxsizes[size * 2 + 1], fxstatus);
+	return floatx80_to_int32(src->fpx, fxstatus);
+}
+static bool fp_is_snan_softfloat(fpdata *fpd)
+{
+	return floatx80_is_signaling_nan(fpd->fpx) != 0;
+}
+static bool fp_is_nan_softfloat(fpdata *fpd)
+{
+	return floatx80_is_nan(fpd->fpx) != 0;
+}
+static bool fp_is_infinity_softfloat(fpdata *fpd)
+{
+	float_class_t fc = floatx80_class(fpd->fpx);
+	return fc == float_negative_inf || fc == float_positive_inf;
+}
+static bool fp_is_zero_softfloat(fpdata *fpd)
+{
+	return floatx80_compare_quiet(fpd->fpx, fxzero, fxstatus) == float_relation_equal;
+}
+static bool fp_is_neg_softfloat(fpdata *fpd)
+{
+	return extractFloatx80Sign(fpd->fpx) != 0;
+}
 #endif
-	return fpd->fp < 0.0;
+
+STATIC_INLINE tointtype toint(fpdata *src, int size)
+{
+	return fpp_toint(src, size);
+}
+STATIC_INLINE bool fp_is_snan(fpdata *fpd)
+{
+	return fpp_is_snan(fpd);
+}
+STATIC_INLINE bool fp_is_nan(fpdata *fpd)
+{
+	return fpp_is_nan(fpd);
+}
+STATIC_INLINE bool fp_is_infinity(fpdata *fpd)
+{
+	return fpp_is_infinity(fpd);
+}
+STATIC_INLINE bool fp_is_zero(fpdata *fpd)
+{
+	return fpp_is_zero(fpd);
+}
+STATIC_INLINE bool fp_is_neg(fpdata *fpd)
+{
+	return fpp_is_neg(fpd);
 }
 
 uae_u32 get_fpsr (void)
@@ -2420,15 +2537,20 @@ static uaecptr fmovem2fpp (uaecptr ad, uae_u32 list, int incr, int regdir)
 }
 
 // round to float
-static void fround (int reg)
+static void fround_fp (int reg)
 {
+	regs.fp[reg].fp = (float)regs.fp[reg].fp;
+}
 #ifdef WITH_SOFTFLOAT
-	if (currprefs.fpu_softfloat) {
-		float32 f = floatx80_to_float32(regs.fp[reg].fpx, fxstatus);
-		regs.fp[reg].fpx = float32_to_floatx80(f, fxstatus);
-	} else
+static void fround_softfloat (int reg)
+{
+	float32 f = floatx80_to_float32(regs.fp[reg].fpx, fxstatus);
+	regs.fp[reg].fpx = float32_to_floatx80(f, fxstatus);
+}
 #endif
-		regs.fp[reg].fp = (float)regs.fp[reg].fp;
+STATIC_INLINE void fround (int reg)
+{
+	fpp_round_single (reg);
 }
 
 static bool arithmetic_fp(fptype src, int reg, int extra)
@@ -2649,10 +2771,155 @@ static bool arithmetic_fp(fptype src, int reg, int extra)
 	return true;
 }
 
+static bool arithmetic_fp_reg(fpdata *srcd, int reg, int extra)
+{
+	return arithmetic_fp(srcd->fp, reg, extra);
+}
+
 #ifdef WITH_SOFTFLOAT
-static bool arithmetic_softfloat(floatx80 *srcd, int reg, int extra)
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2_MATH__)
+/* Host double arithmetic is correctly rounded (no x87 excess precision) */
+#define FPP_HOST_FASTPATH 1
+#endif
+
+#ifdef FPP_HOST_FASTPATH
+
+/* Normal extended values with at most 53 significant bits convert
+ * exactly to host doubles. Exponents are limited so that products and
+ * quotients of two such values can neither overflow nor underflow. */
+static bool floatx80_to_host(floatx80 fx, double *d)
 {
-	floatx80 fx = *srcd;
+	Bit64u sig = extractFloatx80Frac(fx);
+	Bit32s exp = extractFloatx80Exp(fx);
+	uae_u64 v;
+
+	if (!(sig & 0x8000000000000000ULL) || (sig & 0x7ff))
+		return false;
+	if (exp < 0x3fff - 400 || exp > 0x3fff + 400)
+		return false;
+	v = (uae_u64)extractFloatx80Sign(fx) << 63;
+	v |= (uae_u64)(exp - 0x3fff + 0x3ff) << 52;
+	v |= (sig >> 11) & 0x000fffffffffffffULL;
+	memcpy(d, &v, sizeof v);
+	return true;
+}
+
+static bool host_to_floatx80(double d, floatx80 *fx)
+{
+	uae_u64 v;
+	int exp;
+
+	memcpy(&v, &d, sizeof v);
+	exp = (v >> 52) & 0x7ff;
+	// zero, denormal, inf and NaN results go through softfloat
+	if (exp < 2 || exp > 0x7fd)
+		return false;
+	fx->exp = (uae_u16)(((v >> 63) << 15) | (exp - 0x3ff + 0x3fff));
+	fx->fraction = ((v & 0x000fffffffffffffULL) | 0x0010000000000000ULL) << 11;
+	return true;
+}
+
+/* Error free transformations: the rounding error of a + b and a * b
+ * is itself exactly representable, nonzero result means inexact. */
+static double two_sum_err(double a, double b, double s)
+{
+	double bb = s - a;
+	return (a - (s - bb)) + (b - bb);
+}
+static void split(double a, double *hi, double *lo)
+{
+	double t = 134217729.0 * a; // 2^27 + 1
+	*hi = t - (t - a);
+	*lo = a - *hi;
+}
+static double two_prod_err(double a, double b, double p)
+{
+	double ah, al, bh, bl;
+	split(a, &ah, &al);
+	split(b, &bh, &bl);
+	return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+}
+
+/* FADD/FSUB/FMUL/FDIV with double rounding precision, round to nearest
+ * and plain normal operands give the same result on the host FPU as in
+ * softfloat. With extended precision only exact host results are used,
+ * an exact result needs no rounding at any precision. Anything else
+ * (inexact extended results, single precision, other rounding modes,
+ * zeros, denormals, infinities, NaNs, results leaving the double normal
+ * range) returns false and is done by softfloat. */
+static bool arithmetic_softfloat_host(floatx80 *srcd, int reg, int extra)
+{
+	double a, b, r, err;
+	floatx80 fx;
+
+	if ((fxstatus.float_rounding_precision != 64 && fxstatus.float_rounding_precision != 80) || fxstatus.float_rounding_mode != float_round_nearest_even)
+		return false;
+	switch (extra & 0x7f)
+	{
+		case 0x20: /* FDIV */
+		case 0x60: /* FSDIV */
+		case 0x64: /* FDDIV */
+		case 0x22: /* FADD */
+		case 0x62: /* FSADD */
+		case 0x66: /* FDADD */
+		case 0x23: /* FMUL */
+		case 0x63: /* FSMUL */
+		case 0x67: /* FDMUL */
+		case 0x28: /* FSUB */
+		case 0x68: /* FSSUB */
+		case 0x6c: /* FDSUB */
+		break;
+		default:
+		return false;
+	}
+	if (!floatx80_to_host(regs.fp[reg].fpx, &a) || !floatx80_to_host(*srcd, &b))
+		return false;
+	switch (extra & 0x7f)
+	{
+		case 0x20:
+		case 0x60:
+		case 0x64:
+			{
+				// remainder a - r * b, with r * b split into exact ph + pl
+				double ph, pl;
+				r = a / b;
+				ph = r * b;
+				pl = two_prod_err(r, b, ph);
+				err = (a - ph) - pl;
+			}
+			break;
+		case 0x22:
+		case 0x62:
+		case 0x66:
+			r = a + b;
+			err = two_sum_err(a, b, r);
+			break;
+		case 0x23:
+		case 0x63:
+		case 0x67:
+			r = a * b;
+			err = two_prod_err(a, b, r);
+			break;
+		default:
+			r = a - b;
+			err = two_sum_err(a, -b, r);
+			break;
+	}
+	if (err != 0 && fxstatus.float_rounding_precision == 80)
+		return false;
+	if (!host_to_floatx80(r, &fx))
+		return false;
+	if (err != 0)
+		fxstatus.float_exception_flags |= float_flag_inexact;
+	regs.fp[reg].fpx = fx;
+	return true;
+}
+#endif
+
+static bool arithmetic_softfloat(fpdata *srcd, int reg, int extra)
+{
+	floatx80 fx = srcd->fpx;
 	floatx80 f = regs.fp[reg].fpx;
 	int float_rounding_mode;
 	bool sgl = false;
@@ -2663,6 +2930,11 @@ static bool arithmetic_softfloat(floatx80 *srcd, int reg, int extra)
 		fx.fraction |= 0x40000000;
 	}
 
+#ifdef FPP_HOST_FASTPATH
+	if (arithmetic_softfloat_host(&fx, reg, extra))
+		return true;
+#endif
+
 	switch (extra & 0x7f)
 	{
 		case 0x00: /* FMOVE */
@@ -3053,12 +3325,7 @@ static void fpuop_arithmetic2 (uae_u32 opcode, uae_u16 extra)
 			regs.fpiar =  pc;
 
 			CLEAR_STATUS ();
-#ifdef WITH_SOFTFLOAT
-			if (currprefs.fpu_softfloat)
-				v = arithmetic_softfloat(&srcd.fpx, reg, extra);
-			else
-#endif
-				v = arithmetic_fp(srcd.fp, reg, extra);
+			v = fpp_arithmetic(&srcd, reg, extra);
 			if (!v)
 				fpu_noinst (opcode, pc);
 			return;
@@ -3098,8 +3365,52 @@ void fpuop_arithmetic (uae_u32 opcode, uae_u16 extra)
 #endif
 }
 
+static void fpp_set_funcs (void)
+{
+#ifdef WITH_SOFTFLOAT
+	if (currprefs.fpu_softfloat) {
+		fpp_to_single = to_single_softfloat;
+		fpp_from_single = from_single_softfloat;
+		fpp_to_double = to_double_softfloat;
+		fpp_from_double = from_double_softfloat;
+		fpp_to_exten = to_exten_softfloat;
+		fpp_from_exten = from_exten_softfloat;
+		fpp_toint = toint_softfloat;
+		fpp_is_snan = fp_is_snan_softfloat;
+		fpp_is_nan = fp_is_nan_softfloat;
+		fpp_is_infinity = fp_is_infinity_softfloat;
+		fpp_is_zero = fp_is_zero_softfloat;
+		fpp_is_neg = fp_is_neg_softfloat;
+		fpp_get_constant = fpu_get_constant_softfloat;
+		fpp_round_single = fround_softfloat;
+		fpp_arithmetic = arithmetic_softfloat;
+		fpp_make_fpsr = make_fpsr_softfloat;
+		fpp_clear_status = clear_status_softfloat;
+		return;
+	}
+#endif
+	fpp_to_single = to_single_fp;
+	fpp_from_single = from_single_fp;
+	fpp_to_double = to_double_fp;
+	fpp_from_double = from_double_fp;
+	fpp_to_exten = to_exten_fp;
+	fpp_from_exten = from_exten_fp;
+	fpp_toint = toint_fp;
+	fpp_is_snan = fp_is_snan_fp;
+	fpp_is_nan = fp_is_nan_fp;
+	fpp_is_infinity = fp_is_infinity_fp;
+	fpp_is_zero = fp_is_zero_fp;
+	fpp_is_neg = fp_is_neg_fp;
+	fpp_get_constant = fpu_get_constant_fp;
+	fpp_round_single = fround_fp;
+	fpp_arithmetic = arithmetic_fp_reg;
+	fpp_make_fpsr = make_fpsr_fp;
+	fpp_clear_status = clear_status_fp;
+}
+
 void fpu_reset (void)
 {
+	fpp_set_funcs ();
 	regs.fpcr = regs.fpsr = regs.fpiar = 0;
 	regs.fpu_exp_state = 0;
 	fpset (&regs.fp_result, 1);
@@ -3128,6 +3439,7 @@ uae_u8 *restore_fpu (uae_u8 *src)
 	int i;
 	uae_u32 flags;
 
+	fpp_set_funcs ();
 	changed_prefs.fpu_model = currprefs.fpu_model = restore_u32 ();
 	flags = restore_u32 ();
 	for (i = 0; i < 8; i++) {
@@ -13,12 +13,8 @@
 
 #include "genblitter.h"
 
-/* Here is the minterm table used in blitter function generation */
-
-static unsigned char blttbl[]= {
-    0x00, 0x0a, 0x2a, 0x30, 0x3a, 0x3c, 0x4a, 0x6a, 0x8a, 0x8c, 0x9a, 0xa8,
-    0xaa, 0xb1, 0xca, 0xcc, 0xd8, 0xe2, 0xea, 0xf0, 0xfa, 0xfc
-};
+/* Functions are generated for all 256 minterms, each one only
+ * fetching the channels its minterm actually uses. */
 
 static void generate_include(void)
 {
@@ -33,6 +29,32 @@ static void generate_include(void)
     printf("}\n");
 }
 
+/* Channels enabled in BLTCON0 but not used by the minterm are not
+ * fetched in the loop; load their final BLTxDAT (and B hold) afterwards
+ * so the result matches the generic word loop. */
+
+static void generate_unused_dat(int desc, int a_is_on, int b_is_on, int c_is_on)
+{
+    const char *add = desc ? "-" : "+", *sub = desc ? "+" : "-";
+    if (!a_is_on)
+	printf("if (pta) b->bltadat = chipmem_wget_indirect (pta %s (b->hblitsize * 2 + b->bltamod) * b->vblitsize %s b->bltamod %s 2);\n", add, sub, sub);
+    if (!b_is_on) {
+	printf("if (ptb) {\n");
+	printf("\tuaecptr lastb = ptb %s (b->hblitsize * 2 + b->bltbmod) * b->vblitsize %s b->bltbmod %s 2;\n", add, sub, sub);
+	printf("\tuae_u32 prevb = 0;\n");
+	printf("\tif (b->hblitsize > 1) prevb = chipmem_wget_indirect (lastb %s 2);\n", sub);
+	printf("\telse if (b->vblitsize > 1) prevb = chipmem_wget_indirect (lastb %s 2 %s b->bltbmod);\n", sub, sub);
+	printf("\tb->bltbdat = chipmem_wget_indirect (lastb);\n");
+	if (desc)
+	    printf("\tb->bltbhold = (((uae_u32)b->bltbdat << 16) | prevb) >> b->blitdownbshift;\n");
+	else
+	    printf("\tb->bltbhold = ((prevb << 16) | b->bltbdat) >> b->blitbshift;\n");
+	printf("}\n");
+    }
+    if (!c_is_on)
+	printf("if (ptc) b->bltcdat = chipmem_wget_indirect (ptc %s (b->hblitsize * 2 + b->bltcmod) * b->vblitsize %s b->bltcmod %s 2);\n", add, sub, sub);
+}
+
 static void generate_func(void)
 {
     unsigned int i;
@@ -44,10 +66,10 @@ static void generate_func(void)
     printf("#include \"blitter.h\"\n");
     printf("#include \"blitfunc.h\"\n\n");
 
-    for (i = 0; i < sizeof(blttbl); i++) {
-	int active = blitops[blttbl[i]].used;
+    for (i = 0; i < 256; i++) {
+	int active = blitops[i].used;
 	int a_is_on = active & 1, b_is_on = active & 2, c_is_on = active & 4;
-	printf("void blitdofast_%x (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, struct bltinfo *b)\n",blttbl[i]);
+	printf("void blitdofast_%x (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, struct bltinfo *b)\n",i);
 	printf("{\n");
 	printf("int i,j;\n");
 	printf("uae_u32 totald = 0;\n");
@@ -66,7 +88,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tif (pta) {srca=*((uae_u32 *)pta); pta += 4;}\n");
 	if (b_is_on) printf("\t\tif (ptb) {srcb=*((uae_u32 *)ptb); ptb += 4;}\n");
 	if (c_is_on) printf("\t\tif (ptc) {srcc=*((uae_u32 *)ptc); ptc += 4;}\n");
-	printf("\t\tdest = %s;\n", blitops[blttbl[i]].s);
+	printf("\t\tdest = %s;\n", blitops[i].s);
 	printf("\t\ttotald |= dest;\n");
 	printf("\t\tif (ptd) {*(uae_u32 *)ptd=dest; ptd += 4;}\n");
 	printf("\t}\n");
@@ -74,7 +96,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tif (pta) { srca=(uae_u32)*(uae_u16 *)pta; pta += 2; }\n");
 	if (b_is_on) printf("\t\tif (ptb) { srcb=(uae_u32)*(uae_u16 *)ptb; ptb += 2; }\n");
 	if (c_is_on) printf("\t\tif (ptc) { srcc=(uae_u32)*(uae_u16 *)ptc; ptc += 2; }\n");
-	printf("\t\tdest = %s;\n", blitops[blttbl[i]].s);
+	printf("\t\tdest = %s;\n", blitops[i].s);
 	printf("\t\ttotald |= dest;\n");
 	printf("\t\tif (ptd) { *(uae_u16 *)ptd= dest; ptd += 2; }\n");
 	printf("\t}\n");
@@ -106,7 +128,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tsrca = (((uae_u32)preva << 16) | bltadat) >> b->blitashift;\n");
 	if (a_is_on) printf("\t\tpreva = bltadat;\n");
 	printf("\t\tif (dstp) chipmem_wput_indirect (dstp, dstd);\n");
-	printf("\t\tdstd = (%s) & 0xFFFF;\n", blitops[blttbl[i]].s);
+	printf("\t\tdstd = (%s) & 0xFFFF;\n", blitops[i].s);
 	printf("\t\ttotald |= dstd;\n");
 	printf("\t\tif (ptd) { dstp = ptd; ptd += 2; }\n");
 	printf("\t}\n");
@@ -118,13 +140,15 @@ static void generate_func(void)
 	if (b_is_on) printf("b->bltbhold = srcb;\n");
 	if (c_is_on) printf("b->bltcdat = srcc;\n");
 	printf("\t\tif (dstp) chipmem_wput_indirect (dstp, dstd);\n");
+	printf("b->bltddat = dstd;\n");
+	generate_unused_dat(0, a_is_on, b_is_on, c_is_on);
 #if 0
 	printf("}\n");
 #endif
 	printf("if (totald != 0) b->blitzero = 0;\n");
 	printf("}\n");
 
-	printf("void blitdofast_desc_%x (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, struct bltinfo *b)\n",blttbl[i]);
+	printf("void blitdofast_desc_%x (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, struct bltinfo *b)\n",i);
 	printf("{\n");
 	printf("uae_u32 totald = 0;\n");
 	printf("int i,j;\n");
@@ -143,7 +167,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tif (pta) { srca=*((uae_u32 *)(pta-2)); pta -= 4;}\n");
 	if (b_is_on) printf("\t\tif (ptb) { srcb=*((uae_u32 *)(ptb-2)); ptb -= 4;}\n");
 	if (c_is_on) printf("\t\tif (ptc) { srcc=*((uae_u32 *)(ptc-2)); ptc -= 4;}\n");
-	printf("\t\tdest = %s;\n", blitops[blttbl[i]].s);
+	printf("\t\tdest = %s;\n", blitops[i].s);
 	printf("\t\ttotald |= dest;\n");
 	printf("\t\tif (ptd) {*(uae_u32 *)(ptd-2)=dest; ptd -= 4;}\n");
 	printf("\t}\n");
@@ -151,7 +175,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tif (pta) { srca=(uae_u32)*(uae_u16 *)pta; pta -= 2; }\n");
 	if (b_is_on) printf("\t\tif (ptb) { srcb=(uae_u32)*(uae_u16 *)ptb; ptb -= 2; }\n");
 	if (c_is_on) printf("\t\tif (ptc) { srcc=(uae_u32)*(uae_u16 *)ptc; ptc -= 2; }\n");
-	printf("\t\tdest = %s;\n", blitops[blttbl[i]].s);
+	printf("\t\tdest = %s;\n", blitops[i].s);
 	printf("\t\ttotald |= dest;\n");
 	printf("\t\tif (ptd) { *(uae_u16 *)ptd= dest; ptd -= 2; }\n");
 	printf("\t}\n");
@@ -183,7 +207,7 @@ static void generate_func(void)
 	if (a_is_on) printf("\t\tsrca = (((uae_u32)bltadat << 16) | preva) >> b->blitdownashift;\n");
 	if (a_is_on) printf("\t\tpreva = bltadat;\n");
 	printf("\t\tif (dstp) chipmem_wput_indirect (dstp, dstd);\n");
-	printf("\t\tdstd = (%s) & 0xFFFF;\n", blitops[blttbl[i]].s);
+	printf("\t\tdstd = (%s) & 0xFFFF;\n", blitops[i].s);
 	printf("\t\ttotald |= dstd;\n");
 	printf("\t\tif (ptd) { dstp = ptd; ptd -= 2; }\n");
 	printf("\t}\n");
@@ -195,6 +219,8 @@ static void generate_func(void)
 	if (b_is_on) printf("b->bltbhold = srcb;\n");
 	if (c_is_on) printf("b->bltcdat = srcc;\n");
 	printf("\t\tif (dstp) chipmem_wput_indirect (dstp, dstd);\n");
+	printf("b->bltddat = dstd;\n");
+	generate_unused_dat(1, a_is_on, b_is_on, c_is_on);
 #if 0
 	printf("}\n");
 #endif
@@ -205,7 +231,6 @@ static void generate_func(void)
 
 static void generate_table(void)
 {
-    unsigned int index = 0;
     unsigned int i;
     printf("#include \"sysconfig.h\"\n");
     printf("#include \"sysdeps.h\"\n");
@@ -216,24 +241,15 @@ static void generate_table(void)
     printf("#include \"blitfunc.h\"\n\n");
     printf("blitter_func * const blitfunc_dofast[256] = {\n");
     for (i = 0; i < 256; i++) {
-	if (index < sizeof(blttbl) && i == blttbl[index]) {
-	    printf("blitdofast_%x",i);
-	    index++;
-	}
-	else printf("0");
+	printf("blitdofast_%x",i);
 	if (i < 255) printf(", ");
 	if ((i & 7) == 7) printf("\n");
     }
     printf("};\n\n");
 
-    index = 0;
     printf("blitter_func * const blitfunc_dofast_desc[256] = {\n");
     for (i = 0; i < 256; i++) {
-	if (index < sizeof(blttbl) && i == blttbl[index]) {
-	    printf("blitdofast_desc_%x",i);
-	    index++;
-	}
-	else printf("0");
+	printf("blitdofast_desc_%x",i);
 	if (i < 255) printf(", ");
 	if ((i & 7) == 7) printf("\n");
     }
@@ -243,9 +259,9 @@ static void generate_table(void)
 static void generate_header(void)
 {
     unsigned int i;
-    for (i = 0; i < sizeof(blttbl); i++) {
-	printf("extern blitter_func blitdofast_%x;\n",blttbl[i]);
-	printf("extern blitter_func blitdofast_desc_%x;\n",blttbl[i]);
+    for (i = 0; i < 256; i++) {
+	printf("extern blitter_func blitdofast_%x;\n",i);
+	printf("extern blitter_func blitdofast_desc_%x;\n",i);
     }
 }
 
@@ -23,6 +23,7 @@
 #include "savestate.h"
 #include "scsi.h"
 #include "ide.h"
+#include "devices.h"
 
 /* STATUS bits */
 #define IDE_STATUS_ERR 0x01		// 0
@@ -102,6 +103,7 @@ static void ide_interrupt (struct ide_hdf *ide)
 	ide->regs.ide_status |= IDE_STATUS_BSY;
 	ide->regs.ide_status &= ~IDE_STATUS_DRQ;
 	ide->irq_delay = 2;
+	devices_hsync_wake(DEVICE_ID_IDE);
 }
 
 static void ide_fast_interrupt (struct ide_hdf *ide)
@@ -109,6 +111,7 @@ static void ide_fast_interrupt (struct ide_hdf *ide)
 	ide->regs.ide_status |= IDE_STATUS_BSY;
 	ide->regs.ide_status &= ~IDE_STATUS_DRQ;
 	ide->irq_delay = 1;
+	devices_hsync_wake(DEVICE_ID_IDE);
 }
 
 static bool ide_interrupt_do (struct ide_hdf *ide)
@@ -995,6 +998,8 @@ void ide_write_reg (struct ide_hdf *ide, int ide_reg, uae_u32 val)
 		}
 		ide->regs0->ide_devcon = val;
 		ide->regs1->ide_devcon = val;
+		// nIEN change can unmask a pending interrupt
+		devices_irq_dirty(DEVICE_ID_IDE);
 		break;
 	case IDE_DATA:
 		break;
@@ -20,6 +20,7 @@
 #include "debug.h"
 #include "ide.h"
 #include "idecontrollers.h"
+#include "devices.h"
 #include "zfile.h"
 #include "custom.h"
 #include "rommgr.h"
@@ -129,7 +130,7 @@ static bool ide_rethink(struct ide_board *board)
 	return irq;
 }
 
-void idecontroller_rethink(void)
+bool idecontroller_rethink(void)
 {
 	bool irq = false;
 	for (int i = 0; ide_boards[i]; i++) {
@@ -138,6 +139,7 @@ void idecontroller_rethink(void)
 	if (irq && !(intreq & 0x0008)) {
 		INTREQ_0(0x8000 | 0x0008);
 	}
+	return irq;
 }
 
 void idecontroller_hsync(void)
@@ -524,6 +526,7 @@ static uae_u32 ide_read_word(struct ide_board *board, uaecptr addr)
 static void ide_write_byte(struct ide_board *board, uaecptr addr, uae_u8 v)
 {
 	addr &= board->mask;
+	devices_irq_dirty(DEVICE_ID_IDE);
 
 #ifdef JIT
 	special_mem |= S_WRITE;
@@ -614,6 +617,7 @@ static void ide_write_byte(struct ide_board *board, uaecptr addr, uae_u8 v)
 static void ide_write_word(struct ide_board *board, uaecptr addr, uae_u16 v)
 {
 	addr &= board->mask;
+	devices_irq_dirty(DEVICE_ID_IDE);
 
 #ifdef JIT
 	special_mem |= S_WRITE;
@@ -11,3 +11,4 @@ extern void AKIKO_hsync_handler (void);
 extern void akiko_mute (int);
 
 extern void rethink_akiko (void);
+extern void akiko_c2p_selftest (int loops, uae_u32 seed);
@@ -47,6 +47,9 @@ extern void blitter_slowdown (int, int, int, int);
 extern int blitter_channel_state (void);
 extern void blitter_check_start (void);
 extern void blitter_reset (void);
+extern void blitter_dump_stats (void);
+extern void blitter_reset_stats (void);
+extern void blitter_selftest (int loops, uae_u32 seed);
 
 typedef void blitter_func(uaecptr, uaecptr, uaecptr, uaecptr, struct bltinfo *);
 
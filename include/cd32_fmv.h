@@ -2,7 +2,7 @@
 extern addrbank *cd32_fmv_init (uaecptr);
 extern void cd32_fmv_reset(void);
 extern void cd32_fmv_free(void);
-extern void rethink_cd32fmv(void);
+extern bool rethink_cd32fmv(void);
 extern void cd32_fmv_hsync_handler(void);
 extern void cd32_fmv_vsync_handler(void);
 
@@ -11,5 +11,8 @@ extern void cd32_fmv_new_image(int, int, int, uae_u8*);
 extern void cd32_fmv_genlock(struct vidbuffer*, struct vidbuffer*);
 extern void cd32_fmv_new_border_color(uae_u32);
 extern void cd32_fmv_set_sync(double svpos, double adjust);
+extern void cd32_fmv_yuv_to_rgb(uae_u8 *dst, const uae_u8 *y, const uae_u8 *u, const uae_u8 *v, int w, int h, int cw, int ch, int depth);
+extern void cd32_fmv_benchmark(int loops);
+extern void cd32_fmv_genlock_free(void);
 
 extern int cd32_fmv_active;
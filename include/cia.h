@@ -20,6 +20,7 @@ extern void cia_diskindex (void);
 
 extern void dumpcia (void);
 extern void rethink_cias (void);
+extern void cia_selftest (int loops, uae_u32 seed);
 extern int resetwarning_do (int);
 extern void cia_set_overlay (bool);
 
@@ -33,9 +33,17 @@ extern void custom_prepare (void);
 extern void custom_reset (bool hardreset, bool keyboardreset);
 extern int intlev (void);
 extern void dumpcustom (void);
+extern void custom_fetch_selftest (int loops, uae_u32 seed);
 
 extern void do_disk (void);
 extern void do_copper (void);
+extern void copper_dump_stats (void);
+extern void copper_reset_stats (void);
+extern void custom_wstats_enable (const TCHAR *csvfile);
+extern void custom_wstats_reset (void);
+extern void custom_wstats_dump (void);
+extern bool custom_wstats_save (const TCHAR *csvfile);
+extern void custom_wstats_free (void);
 
 extern void notice_new_xcolors (void);
 extern void notice_screen_contents_lost (void);
@@ -4,6 +4,16 @@ void devices_vsync_pre(void);
 void devices_vsync_post(void);
 void devices_hsync(void);
 void devices_rethink(void);
+
+// devices with sleeping hsync handlers or dirty interrupt tracking
+enum {
+	DEVICE_ID_NONE = -1,
+	DEVICE_ID_IDE,
+	DEVICE_ID_CD32FMV,
+	DEVICE_ID_MAX
+};
+void devices_hsync_wake(int id);
+void devices_irq_dirty(int id);
 void devices_update_sound(double clk, double syncadjust);
 void devices_update_sync(double svpos, double syncadjust);
 void reset_all_systems(void);
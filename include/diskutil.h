@@ -1,3 +1,11 @@
 
 int isamigatrack (uae_u16 *amigamfmbuffer, uae_u8 *mfmdata, int len, uae_u8 *writebuffer, uae_u8 *writebuffer_ok, int track, int *outsize);
 int ispctrack (uae_u16 *amigamfmbuffer, uae_u8 *mfmdata, int len, uae_u8 *writebuffer, uae_u8 *writebuffer_ok, int track, int *outsize);
+
+uae_u16 mfm_encode_byte (uae_u8 v);
+uae_u8 mfm_decode_byte (uae_u16 mfm);
+void mfm_clock (uae_u16 *mfm, int words, uae_u16 prev);
+uae_u32 mfm_encode_oddeven (const uae_u8 *src, uae_u16 *odd, uae_u16 *even, int bytes);
+uae_u32 mfm_decode_oddeven (const uae_u16 *odd, const uae_u16 *even, int shift, uae_u8 *dst, int bytes);
+uae_u32 mfm_decode_oddeven_b (const uae_u8 *odd, const uae_u8 *even, uae_u8 *dst, int bytes);
+void mfm_benchmark (int loops);
@@ -290,6 +290,8 @@ extern void get_custom_raw_limits (int *pw, int *ph, int *pdx, int *pdy);
 extern void putpixel (uae_u8 *buf, int bpp, int x, xcolnr c8, int opaq);
 extern void allocvidbuffer (struct vidbuffer *buf, int width, int height, int depth);
 extern void freevidbuffer (struct vidbuffer *buf);
+extern void drawing_sprite_span_selftest (int loops, uae_u32 seed);
+extern void drawing_ham_selftest (int loops, uae_u32 seed);
 
 /* Finally, stuff that shouldn't really be shared.  */
 
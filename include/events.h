@@ -54,6 +54,7 @@ struct ev2
     evt evtime;
     uae_u32 data;
     evfunc2 handler;
+    int heap; /* position in pending queue + 1, 0 = not queued */
 };
 
 enum {
@@ -62,8 +63,7 @@ enum {
 };
 
 enum {
-    ev2_blitter, ev2_disk, ev2_misc,
-    ev2_max = 12
+    ev2_blitter, ev2_disk, ev2_misc
 };
 
 extern int pissoff_value;
@@ -73,7 +73,8 @@ extern signed long pissoff;
 #define do_cycles do_cycles_slow
 
 extern struct ev eventtab[ev_max];
-extern struct ev2 eventtab2[ev2_max];
+extern struct ev2 *eventtab2;
+extern int ev2_max;
 
 extern volatile bool vblank_found_chipset;
 extern volatile bool vblank_found_rtg;
@@ -128,7 +129,11 @@ STATIC_INLINE bool cycles_in_range (unsigned long endcycles)
 }
 
 extern void MISC_handler (void);
+extern void init_eventtab2 (void);
 extern void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func);
+extern void event2_remevent (int no);
+extern void events_dump (void);
+extern void events_reset_stats (void);
 
 STATIC_INLINE void event2_newevent_x (int no, evt t, uae_u32 data, evfunc2 func)
 {
@@ -148,10 +153,5 @@ STATIC_INLINE void event2_newevent2 (evt t, uae_u32 data, evfunc2 func)
 	event2_newevent_x (-1, t, data, func);
 }
 
-STATIC_INLINE void event2_remevent (int no)
-{
-	eventtab2[no].active = 0;
-}
-
 
 #endif
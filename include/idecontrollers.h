@@ -3,7 +3,7 @@
 void idecontroller_free_units(void);
 void idecontroller_free(void);
 void idecontroller_reset(void);
-void idecontroller_rethink(void);
+bool idecontroller_rethink(void);
 void idecontroller_hsync(void);
 
 int gvp_add_ide_unit(int ch, struct uaedev_config_info *ci);
@@ -543,6 +543,10 @@ extern void m68k_go (int);
 extern void m68k_dumpstate (uaecptr *);
 extern void m68k_dumpstate (uaecptr, uaecptr *);
 extern void m68k_dumpcache (void);
+extern void cpu_selftest (int count, int core1, int core2, uae_u32 seed);
+extern int cpu_ce_adaptive;
+extern void cpu_ce_adaptive_access (void);
+extern void cpu_ce_adaptive_hsync (bool chipset_idle);
 extern int getDivu68kCycles (uae_u32 dividend, uae_u16 divisor);
 extern int getDivs68kCycles (uae_s32 dividend, uae_s16 divisor);
 extern void divbyzero_special (bool issigned, uae_s32 dst);
@@ -624,6 +628,8 @@ extern void flush_icache(uaecptr, int);
 extern void flush_icache_hard(uaecptr, int);
 extern void compemu_reset(void);
 extern bool check_prefs_changed_comp (void);
+extern void compemu_dump_stats(void);
+extern void compemu_reset_stats(void);
 #else
 #define flush_icache(uaecptr, int) do {} while (0)
 #define flush_icache_hard(uaecptr, int) do {} while (0)
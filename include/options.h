@@ -424,6 +424,7 @@ struct uae_prefs {
 	int cpu_idle;
 	int ppc_cpu_idle;
 	bool cpu_cycle_exact;
+	bool cpu_cycle_exact_adaptive;
 	int cpu_clock_multiplier;
 	int cpu_frequency;
 	bool blitter_cycle_exact;
@@ -433,6 +434,9 @@ struct uae_prefs {
 	int floppy_random_bits_max;
 	int floppy_auto_ext2;
 	int cd_speed;
+	int cd_block_cache;
+	bool cd_audio_predecode;
+	bool cd_audio_cache;
 	bool tod_hack;
 	uae_u32 maprom;
 	bool rom_readwrite;
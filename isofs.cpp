@@ -18,7 +18,6 @@
 
 #include "isofs.h"
 
-#define MAX_CACHED_BH_COUNT 100
 //#define MAX_CACHE_INODE_COUNT 10
 #define HASH_SIZE 65536
 
@@ -41,8 +40,6 @@ struct buffer_head
 	struct buffer_head *next;
 	uae_u8 *b_data;
 	uae_u32 b_blocknr;
-	bool linked;
-	int usecnt;
 	struct super_block *sb;
 };
 
@@ -108,7 +105,7 @@ static void free_bh(struct buffer_head *bh)
 	if (!bh)
 		return;
 	bh->sb->bh_count--;
-	xfree(bh->b_data);
+	blkdev_cache_release(bh->sb->unitnum, bh->b_data);
 	xfree(bh);
 }
 
@@ -181,56 +178,38 @@ static struct inode *find_inode(struct super_block *sb, uae_u64 uniq)
 	return NULL;
 }
 
+// block data is pinned in the blkdev block cache until brelse()
 static buffer_head *sb_bread(struct super_block *sb, uae_u32 block)
 {
 	struct buffer_head *bh;
-	
-	bh = sb->buffer_heads;
-	while (bh) {
-		if (bh->b_blocknr == block) {
-			bh->usecnt++;
-			return bh;
-		}
-		bh = bh->next;
-	}
-	// simple LRU block cache. Should be in blkdev, not here..
-	while (sb->bh_count > MAX_CACHED_BH_COUNT) {
-		struct buffer_head *minbh = NULL, *minbhprev = NULL;
-		struct buffer_head *prev = NULL;
-		bh = sb->buffer_heads;
-		while (bh) {
-			if (minbh == NULL || bh->usecnt < minbh->usecnt) {
-				minbh = bh;
-				minbhprev = prev;
-			}
-			prev = bh;
-			bh = bh->next;
-		}
-		if (minbh) {
-			if (minbhprev)
-				minbhprev->next = minbh->next;
-			else
-				sb->buffer_heads = minbh->next;
-			free_bh(minbh);
-		}
-	}
+	uae_u8 *data;
+
+	data = blkdev_cache_read (sb->unitnum, block);
+	if (!data)
+		return NULL;
 	bh = xcalloc (struct buffer_head, 1);
 	bh->sb = sb;
-	bh->b_data = xmalloc (uae_u8, CD_BLOCK_SIZE);
+	bh->b_data = data;
 	bh->b_blocknr = block;
-	if (sys_command_cd_read (sb->unitnum, bh->b_data, block, 1)) {
-		bh->next = sb->buffer_heads;
-		sb->buffer_heads = bh;
-		bh->linked = true;
-		sb->bh_count++;
-		return bh;
-	}
-	xfree (bh);
-	return NULL;
+	bh->next = sb->buffer_heads;
+	sb->buffer_heads = bh;
+	sb->bh_count++;
+	return bh;
 }
 
 static void brelse(struct buffer_head *sh)
 {
+	struct buffer_head **bhp;
+
+	if (!sh)
+		return;
+	for (bhp = &sh->sb->buffer_heads; *bhp; bhp = &(*bhp)->next) {
+		if (*bhp == sh) {
+			*bhp = sh->next;
+			break;
+		}
+	}
+	free_bh(sh);
 }
 
 static TCHAR *getname(char *name, int len)
@@ -2150,6 +2129,7 @@ static struct inode *isofs_find_entry(struct inode *dir, char *tmpname, TCHAR *t
 		/* Basic sanity check, whether name doesn't exceed dir entry */
 		if (de_len < dlen + sizeof(struct iso_directory_record)) {
 			write_log (_T("iso9660: Corrupted directory entry in block %u of inode %u\n"), block, dir->i_ino);
+			brelse(bh);
 			return 0;
 		}
 
@@ -2293,6 +2273,7 @@ static int do_isofs_readdir(struct inode *inode, struct file *filp, char *tmpnam
 		/* Basic sanity check, whether name doesn't exceed dir entry */
 		if (de_len < de->name_len[0] + sizeof(struct iso_directory_record)) {
 			write_log (_T("iso9660: Corrupted directory entry in block %u of inode %u\n"), block, inode->i_ino);
+			brelse(bh);
 			return 0;
 		}
 
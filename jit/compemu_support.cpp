@@ -43,6 +43,22 @@ int soft_flush_count=0;
 int hard_flush_count=0;
 int compile_count=0;
 int checksum_count=0;
+
+/* Block tier counters, shown by the debugger "J" command. The exit
+   counters are counted when blocks are compiled, not when they run. */
+#define JITSTAT_LEVELS 10
+static struct {
+	int compiled[JITSTAT_LEVELS];	/* blocks (re)compiled per optimization level */
+	int promoted;			/* countdown expired, block recompiled at next level */
+	int cache_miss;
+	int checksum_ok;
+	int checksum_fail;
+	int site_chained;		/* patchable direct exit sites emitted */
+	int site_dispatch;		/* cache_tags[] lookup exit sites emitted */
+	int blocks_interp;		/* optlevel 0 blocks, run through exec_nostats */
+	uae_u32 insns;
+	uae_u32 code_bytes;
+} jitstats;
 static uae_u8* current_compile_p=NULL;
 static uae_u8* max_compile_start;
 uae_u8* compiled_code=NULL;
@@ -325,6 +341,7 @@ STATIC_INLINE void create_jmpdep(blockinfo* bi, int i, uae_u32* jmpaddr, uae_u32
 		bi->dep[i].next->prev_p=&(bi->dep[i].next);
 	bi->dep[i].prev_p=&(tbi->deplist);
 	tbi->deplist=&(bi->dep[i]);
+	jitstats.site_chained++;
 }
 
 STATIC_INLINE void big_to_small_state(bigstate* b, smallstate* s)
@@ -5344,6 +5361,58 @@ uae_u32 get_jitted_size(void)
 	return 0;
 }
 
+void compemu_reset_stats(void)
+{
+	memset(&jitstats,0,sizeof jitstats);
+}
+
+static void count_blocks(blockinfo* bi, int* levels, int* chained)
+{
+	while (bi) {
+		dependency* x=bi->deplist;
+		levels[bi->optlevel < JITSTAT_LEVELS ? bi->optlevel : JITSTAT_LEVELS - 1]++;
+		while (x) {
+			(*chained)++;
+			x=x->next;
+		}
+		bi=bi->next;
+	}
+}
+
+void compemu_dump_stats(void)
+{
+	int active_lvl[JITSTAT_LEVELS]={0};
+	int dormant_lvl[JITSTAT_LEVELS]={0};
+	int chained=0;
+	int compiled=0;
+	int i;
+
+	for (i=0;i<JITSTAT_LEVELS;i++)
+		compiled+=jitstats.compiled[i];
+	count_blocks(active,active_lvl,&chained);
+	count_blocks(dormant,dormant_lvl,&chained);
+
+	console_out_f(_T("JIT: %s, cache %u/%u bytes used\n"),
+		letit ? _T("enabled") : _T("disabled"),
+		get_jitted_size(),currprefs.cachesize*1024);
+	console_out_f(_T("Totals: compiles %d, flushes soft %d hard %d, checksums %d\n"),
+		compile_count,soft_flush_count,hard_flush_count,checksum_count);
+	console_out_f(_T("Compiles %d, promotions %d, instructions %u, code %u bytes (%u/insn)\n"),
+		compiled,jitstats.promoted,jitstats.insns,jitstats.code_bytes,
+		jitstats.insns ? jitstats.code_bytes/jitstats.insns : 0);
+	console_out_f(_T("Checksums ok %d, changed %d, cache misses %d\n"),
+		jitstats.checksum_ok,jitstats.checksum_fail,jitstats.cache_miss);
+	console_out_f(_T("Compiled exit sites: chained %d, dispatched %d. Interpreted blocks %d, live chain links %d\n"),
+		jitstats.site_chained,jitstats.site_dispatch,jitstats.blocks_interp,chained);
+	console_out_f(_T("Level  Compiled  Active  Dormant\n"));
+	for (i=0;i<JITSTAT_LEVELS;i++) {
+		if (!jitstats.compiled[i] && !active_lvl[i] && !dormant_lvl[i])
+			continue;
+		console_out_f(_T("%5d %9d %7d %8d\n"),
+			i,jitstats.compiled[i],active_lvl[i],dormant_lvl[i]);
+	}
+}
+
 void alloc_cache(void)
 {
 	if (compiled_code) {
@@ -5447,6 +5516,7 @@ static void recompile_block(void)
 
 	Dif (!bi)
 		jit_abort (_T("recompile_block"));
+	jitstats.promoted++;
 	raise_in_cl_list(bi);
 	execute_normal();
 	return;
@@ -5465,6 +5535,7 @@ static void cache_miss(void)
 	Dif (!bi2 || bi==bi2) {
 		jit_abort (_T("Unexplained cache miss %p %p\n"),bi,bi2);
 	}
+	jitstats.cache_miss++;
 	raise_in_cl_list(bi);
 	return;
 }
@@ -5500,6 +5571,7 @@ static void check_checksum(void)
 	if (c1==bi->c1 && c2==bi->c2) {
 		/* This block is still OK. So we reactivate. Of course, that
 		means we have to move it into the needs-to-be-flushed list */
+		jitstats.checksum_ok++;
 		bi->handler_to_use=bi->handler;
 		set_dhtu(bi,bi->direct_handler);
 
@@ -5514,6 +5586,7 @@ static void check_checksum(void)
 		and set it up to be recompiled */
 		/* write_log (_T("JIT: discard %p/%p (%x %x/%x %x)\n"),bi,bi->pc_p,
 		c1,c2,bi->c1,bi->c2); */
+		jitstats.checksum_fail++;
 		invalidate_block(bi);
 		raise_in_cl_list(bi);
 		execute_normal();
@@ -5984,6 +6057,7 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 			raw_jl((uae_u32)popall_recompile_block);
 		}
 		if (optlev==0) { /* No need to actually translate */
+			jitstats.blocks_interp++;
 			/* Execute normally without keeping stats */
 			raw_mov_l_mi((uae_u32)&regs.pc_p,(uae_u32)pc_hist[0].location);
 			raw_jmp((uae_u32)popall_exec_nostats);
@@ -6182,6 +6256,7 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 					raw_sub_l_mi((uae_u32)&countdown,scaled_cycles(totcycles));
 					raw_cmov_l_rm_indexed(r2,(uae_u32)cache_tags,r,9);
 					raw_jmp_r(r2);
+					jitstats.site_dispatch++;
 				}
 				else if (was_comp && isconst(PC_P)) {
 					uae_u32 v=live.state[PC_P].val;
@@ -6214,6 +6289,7 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 					raw_sub_l_mi((uae_u32)&countdown,scaled_cycles(totcycles));
 					raw_cmov_l_rm_indexed(r2,(uae_u32)cache_tags,r,9);
 					raw_jmp_r(r2);
+					jitstats.site_dispatch++;
 				}
 			}
 		}
@@ -6226,6 +6302,9 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 		bi->len=max_pcp-min_pcp;
 		bi->min_pcp=min_pcp;
 
+		jitstats.compiled[optlev < JITSTAT_LEVELS ? optlev : JITSTAT_LEVELS - 1]++;
+		jitstats.insns+=blocklen;
+
 		remove_from_list(bi);
 		if (isinrom(min_pcp) && isinrom(max_pcp))
 			add_to_dormant(bi); /* No need to checksum it on cache flush.
@@ -6238,6 +6317,7 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 
 		log_dump();
 		align_target(32);
+		jitstats.code_bytes+=get_target()-(uae_u8*)bi->handler;
 		current_compile_p=get_target();
 
 		raise_in_cl_list(bi);
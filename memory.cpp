@@ -719,6 +719,16 @@ static void REGPARAM2 chipmem_agnus_bput (uaecptr addr, uae_u32 b)
 	chipmem_bank.baseaddr[addr] = b;
 }
 
+/* host view of chip RAM as seen by chipset DMA, NULL if not directly
+ * addressable. Addresses below *size do not wrap. */
+uae_u8 *chipmem_dma_base (uae_u32 *size)
+{
+	if (currprefs.z3chipmem_size || !chipmem_bank.baseaddr)
+		return NULL;
+	*size = chipmem_full_size < chipmem_full_mask + 1 ? chipmem_full_size : chipmem_full_mask + 1;
+	return chipmem_bank.baseaddr;
+}
+
 static int REGPARAM2 chipmem_check (uaecptr addr, uae_u32 size)
 {
 	addr &= chipmem_bank.mask;
@@ -98,6 +98,25 @@ static int icachelinecnt, dcachelinecnt;
 static struct cache040 icaches040[CACHESETS040];
 static struct cache040 dcaches040[CACHESETS040];
 
+/* 68040 instruction cache line lookaside: last hit line per even/odd
+ * line address, so sequential fetches skip the 4-way tag search.
+ * key = line address | S, ICACHE040_PD_NONE = empty.
+ */
+#define ICACHE040_PD_NONE 0xffffffff
+struct icache040_pd
+{
+	uae_u32 key;
+	struct cache040 *c;
+	int line;
+};
+static struct icache040_pd icache040_pd[2] = { { ICACHE040_PD_NONE }, { ICACHE040_PD_NONE } };
+
+static void icache040_pd_reset (void)
+{
+	icache040_pd[0].key = ICACHE040_PD_NONE;
+	icache040_pd[1].key = ICACHE040_PD_NONE;
+}
+
 #if COUNT_INSTRS
 static unsigned long int instrcount[65536];
 static uae_u16 opcodenums[65536];
@@ -737,6 +756,57 @@ static void set_x_ifetches(void)
 	}
 }
 
+/* Adaptive cycle-exact: skip per-cycle chipset sync while CPU stays off
+ * the chip bus and blitter and copper are idle. Any CPU chip bus access
+ * (dma_cycle()) switches back to full cycle-exact immediately, hsync
+ * re-enables fast mode after CE_ADAPTIVE_IDLE_LINES quiet lines.
+ */
+#define CE_ADAPTIVE_IDLE_LINES 2
+int cpu_ce_adaptive;
+static bool ce_adaptive_fast, ce_adaptive_chip;
+static int ce_adaptive_idle;
+
+static void set_x_cycles_adaptive (void)
+{
+	if (ce_adaptive_fast) {
+		x_do_cycles = do_cycles;
+		x_do_cycles_pre = do_cycles;
+		x_do_cycles_post = do_cycles_post;
+	} else if (currprefs.cpu_model < 68020) {
+		x_do_cycles = do_cycles_ce;
+		x_do_cycles_pre = do_cycles_ce;
+		x_do_cycles_post = do_cycles_ce_post;
+	} else {
+		x_do_cycles = do_cycles_ce020;
+		x_do_cycles_pre = do_cycles_ce020;
+		x_do_cycles_post = do_cycles_ce020_post;
+	}
+}
+
+void cpu_ce_adaptive_access (void)
+{
+	ce_adaptive_chip = true;
+	if (ce_adaptive_fast) {
+		ce_adaptive_fast = false;
+		set_x_cycles_adaptive ();
+	}
+}
+
+void cpu_ce_adaptive_hsync (bool chipset_idle)
+{
+	if (!chipset_idle || ce_adaptive_chip) {
+		ce_adaptive_idle = 0;
+		if (ce_adaptive_fast) {
+			ce_adaptive_fast = false;
+			set_x_cycles_adaptive ();
+		}
+	} else if (!ce_adaptive_fast && ++ce_adaptive_idle >= CE_ADAPTIVE_IDLE_LINES) {
+		ce_adaptive_fast = true;
+		set_x_cycles_adaptive ();
+	}
+	ce_adaptive_chip = false;
+}
+
 // indirect memory access functions
 static void set_x_funcs (void)
 {
@@ -963,6 +1033,12 @@ static void set_x_funcs (void)
 		x_do_cycles_pre = do_cycles_ce020;
 		x_do_cycles_post = do_cycles_ce020_post;
 	}
+	cpu_ce_adaptive = currprefs.cpu_cycle_exact && currprefs.cpu_cycle_exact_adaptive &&
+		currprefs.cpu_model < 68040 && !currprefs.mmu_model && !cpu_tracer;
+	if (!cpu_ce_adaptive)
+		ce_adaptive_fast = false;
+	if (ce_adaptive_fast)
+		set_x_cycles_adaptive ();
 	x2_prefetch = x_prefetch;
 	x2_get_ilong = x_get_ilong;
 	x2_get_iword = x_get_iword;
@@ -1099,6 +1175,7 @@ void flush_cpu_caches(bool force)
 	} else if (currprefs.cpu_model >= 68040) {
 		icachelinecnt = 0;
 		dcachelinecnt = 0;
+		icache040_pd_reset ();
 		if (doflush) {
 			for (int i = 0; i < CACHESETS040; i++) {
 				icaches040[i].valid[0] = 0;
@@ -1122,6 +1199,7 @@ void set_cpu_caches (bool flush)
 {
 	regs.prefetch020addr = 0xffffffff;
 	regs.cacheholdingaddr020 = 0xffffffff;
+	icache040_pd_reset ();
 
 #ifdef JIT
 	if (currprefs.cachesize) {
@@ -1173,46 +1251,16 @@ static const struct cputbl *cputbls[6][5] =
 	{ op_smalltbl_0_ff, op_smalltbl_40_ff, op_smalltbl_24_ff, op_smalltbl_24_ff, op_smalltbl_33_ff }
 };
 
-static void build_cpufunctbl (void)
+static int build_functbl (cpuop_func **functbl, const struct cputbl *tbl, int lvl)
 {
 	int i, opcnt;
 	unsigned long opcode;
-	const struct cputbl *tbl = 0;
-	int lvl, mode;
-
-	if (!currprefs.cachesize) {
-		if (currprefs.mmu_model)
-			mode = 4;
-		else if (currprefs.cpu_cycle_exact)
-			mode = 3;
-		else if (currprefs.cpu_compatible)
-			mode = 2;
-		else
-			mode = 0;
-		m68k_pc_indirect = mode != 0 ? 1 : 0;
-	} else {
-		mode = 0;
-		m68k_pc_indirect = 0;
-		if (currprefs.comptrustbyte) {
-			mode = 1;
-			m68k_pc_indirect = -1;
-		}
-	}
-	lvl = (currprefs.cpu_model - 68000) / 10;
-	if (lvl == 6)
-		lvl = 5;
-	tbl = cputbls[lvl][mode];
-
-	if (tbl == NULL) {
-		write_log (_T("no CPU emulation cores available CPU=%d!"), currprefs.cpu_model);
-		abort ();
-	}
 
 	for (opcode = 0; opcode < 65536; opcode++)
-		cpufunctbl[opcode] = op_illg_1;
+		functbl[opcode] = op_illg_1;
 	for (i = 0; tbl[i].handler != NULL; i++) {
 		opcode = tbl[i].opcode;
-		cpufunctbl[opcode] = tbl[i].handler;
+		functbl[opcode] = tbl[i].handler;
 	}
 
 	/* hack fpu to 68000/68010 mode */
@@ -1220,7 +1268,7 @@ static void build_cpufunctbl (void)
 		tbl = op_smalltbl_3_ff;
 		for (i = 0; tbl[i].handler != NULL; i++) {
 			if ((tbl[i].opcode & 0xfe00) == 0xf200)
-				cpufunctbl[tbl[i].opcode] = tbl[i].handler;
+				functbl[tbl[i].opcode] = tbl[i].handler;
 		}
 	}
 
@@ -1235,12 +1283,12 @@ static void build_cpufunctbl (void)
 		/* unimplemented opcode? */
 		if (table->unimpclev > 0 && lvl >= table->unimpclev) {
 			if (currprefs.int_no_unimplemented && currprefs.cpu_model == 68060) {
-				cpufunctbl[opcode] = op_unimpl_1;
+				functbl[opcode] = op_unimpl_1;
 				continue;
 			} else {
 				// emulate 68060 unimplemented instructions if int_no_unimplemented=false
 				if (currprefs.cpu_model != 68060 && table->unimpclev != 5) {
-					cpufunctbl[opcode] = op_illg_1;
+					functbl[opcode] = op_illg_1;
 					continue;
 				}
 			}
@@ -1256,13 +1304,57 @@ static void build_cpufunctbl (void)
 
 		if (table->handler != -1) {
 			int idx = table->handler;
-			f = cpufunctbl[idx];
+			f = functbl[idx];
 			if (f == op_illg_1)
 				abort ();
-			cpufunctbl[opcode] = f;
+			functbl[opcode] = f;
 			opcnt++;
 		}
 	}
+	return opcnt;
+}
+
+static int get_cpu_level (void)
+{
+	int lvl = (currprefs.cpu_model - 68000) / 10;
+	if (lvl == 6)
+		lvl = 5;
+	return lvl;
+}
+
+static void build_cpufunctbl (void)
+{
+	int opcnt;
+	const struct cputbl *tbl = 0;
+	int lvl, mode;
+
+	if (!currprefs.cachesize) {
+		if (currprefs.mmu_model)
+			mode = 4;
+		else if (currprefs.cpu_cycle_exact)
+			mode = 3;
+		else if (currprefs.cpu_compatible)
+			mode = 2;
+		else
+			mode = 0;
+		m68k_pc_indirect = mode != 0 ? 1 : 0;
+	} else {
+		mode = 0;
+		m68k_pc_indirect = 0;
+		if (currprefs.comptrustbyte) {
+			mode = 1;
+			m68k_pc_indirect = -1;
+		}
+	}
+	lvl = get_cpu_level ();
+	tbl = cputbls[lvl][mode];
+
+	if (tbl == NULL) {
+		write_log (_T("no CPU emulation cores available CPU=%d!"), currprefs.cpu_model);
+		abort ();
+	}
+
+	opcnt = build_functbl (cpufunctbl, tbl, lvl);
 	write_log (_T("Building CPU, %d opcodes (%d %d %d)\n"),
 		opcnt, lvl,
 		currprefs.cpu_cycle_exact ? -1 : currprefs.cpu_compatible ? 1 : 0, currprefs.address_space_24);
@@ -1384,6 +1476,7 @@ static void prefs_changed_cpu (void)
 	currprefs.mmu_model = changed_prefs.mmu_model;
 	currprefs.cpu_compatible = changed_prefs.cpu_compatible;
 	currprefs.cpu_cycle_exact = changed_prefs.cpu_cycle_exact;
+	currprefs.cpu_cycle_exact_adaptive = changed_prefs.cpu_cycle_exact_adaptive;
 	currprefs.int_no_unimplemented = changed_prefs.int_no_unimplemented;
 	currprefs.fpu_no_unimplemented = changed_prefs.fpu_no_unimplemented;
 	currprefs.blitter_cycle_exact = changed_prefs.blitter_cycle_exact;
@@ -1403,7 +1496,8 @@ static int check_prefs_changed_cpu2(void)
 		|| currprefs.int_no_unimplemented != changed_prefs.int_no_unimplemented
 		|| currprefs.fpu_no_unimplemented != changed_prefs.fpu_no_unimplemented
 		|| currprefs.cpu_compatible != changed_prefs.cpu_compatible
-		|| currprefs.cpu_cycle_exact != changed_prefs.cpu_cycle_exact) {
+		|| currprefs.cpu_cycle_exact != changed_prefs.cpu_cycle_exact
+		|| currprefs.cpu_cycle_exact_adaptive != changed_prefs.cpu_cycle_exact_adaptive) {
 			cpu_prefs_changed_flag |= 1;
 	}
 	if (changed
@@ -5565,6 +5659,255 @@ void m68k_dumpcache (void)
 	}
 }
 
+/* CPU core self test: run random single instructions through two
+ * cpu emulation cores from identical state and compare the results.
+ * Uses first 128k of chip ram, saved and restored afterwards.
+ */
+
+#define CPUTEST_SIZE 0x20000
+#define CPUTEST_CODE 0x10000
+#define CPUTEST_HANDLER 0x1f000
+#define CPUTEST_USP 0x1d000
+#define CPUTEST_ISP 0x1e000
+#define CPUTEST_MAXERRORS 10
+
+struct cputest_result
+{
+	uae_u32 regs[16];
+	uae_u32 pc, sr, sp2;
+	bool fault;
+};
+
+static const TCHAR *cputest_names[] = { _T("generic"), _T("generic-indirect"), _T("prefetch"), _T("cycle-exact") };
+
+static bool cputest_opcode (uae_u16 opcode, int lvl)
+{
+	instr *table = &table68k[opcode];
+
+	if (table->mnemo == i_ILLG || table->clev > lvl)
+		return false;
+	if (table->unimpclev > 0 && lvl >= table->unimpclev)
+		return false;
+	/* keep all effective addresses inside the test area */
+	if (table->smode == Ad8r || table->smode == PC8r || table->smode == absw || table->smode == absl)
+		return false;
+	if (table->dmode == Ad8r || table->dmode == PC8r || table->dmode == absw || table->dmode == absl)
+		return false;
+	switch (table->mnemo)
+	{
+		case i_RESET: case i_STOP: case i_LPSTOP:
+		case i_MOVEC2: case i_MOVE2C: case i_MOVES:
+		case i_CAS2: case i_MOVE16: case i_CALLM: case i_RTM: case i_BKPT:
+		case i_FPP: case i_FDBcc: case i_FScc: case i_FTRAPcc: case i_FBcc: case i_FSAVE: case i_FRESTORE:
+		case i_CINVL: case i_CINVP: case i_CINVA: case i_CPUSHL: case i_CPUSHP: case i_CPUSHA:
+		case i_MMUOP030: case i_PFLUSHN: case i_PFLUSH: case i_PFLUSHAN: case i_PFLUSHA:
+		case i_PLPAR: case i_PLPAW: case i_PTESTR: case i_PTESTW:
+		return false;
+		case i_BFTST: case i_BFEXTU: case i_BFCHG: case i_BFEXTS:
+		case i_BFCLR: case i_BFFFO: case i_BFSET: case i_BFINS:
+		/* bitfield target is the destination ea, memory forms can reach far outside the test area */
+		return table->dmode == Dreg;
+	}
+	return true;
+}
+
+static void cputest_setmode (int mode)
+{
+	currprefs.cpu_compatible = mode >= 2;
+	currprefs.cpu_cycle_exact = mode == 3;
+	m68k_pc_indirect = mode == 0 ? 0 : (mode == 1 ? -1 : 1);
+	set_x_funcs ();
+}
+
+static void cputest_run (cpuop_func **functbl, int mode, uae_u16 opcode, uae_u8 *mem, uae_u8 *initmem, struct regstruct *initregs, struct cputest_result *res)
+{
+	memcpy (mem, initmem, CPUTEST_SIZE);
+	regs = *initregs;
+	cputest_setmode (mode);
+	flush_cpu_caches (true);
+	m68k_setpc_normal (CPUTEST_CODE);
+	fill_prefetch ();
+	regs.opcode = opcode;
+	regs.instruction_pc = CPUTEST_CODE;
+	res->fault = false;
+	TRY(prb) {
+		(*functbl[opcode])(opcode);
+	} CATCH(prb) {
+		res->fault = true;
+	} ENDTRY
+	MakeSR ();
+	memcpy (res->regs, regs.regs, sizeof res->regs);
+	res->pc = m68k_getpc ();
+	res->sr = regs.sr;
+	res->sp2 = regs.s ? regs.usp : (regs.m ? regs.msp : regs.isp);
+}
+
+static bool cputest_compare (struct cputest_result *r1, struct cputest_result *r2, uae_u8 *mem1, uae_u8 *mem2, bool report)
+{
+	bool ok = true;
+
+	for (int i = 0; i < 16; i++) {
+		if (r1->regs[i] != r2->regs[i]) {
+			if (report)
+				console_out_f (_T(" %c%d: %08X %08X\n"), i < 8 ? 'D' : 'A', i & 7, r1->regs[i], r2->regs[i]);
+			ok = false;
+		}
+	}
+	if (r1->pc != r2->pc) {
+		if (report)
+			console_out_f (_T(" PC: %08X %08X\n"), r1->pc, r2->pc);
+		ok = false;
+	}
+	if (r1->sr != r2->sr) {
+		if (report)
+			console_out_f (_T(" SR: %04X %04X\n"), r1->sr, r2->sr);
+		ok = false;
+	}
+	if (r1->sp2 != r2->sp2) {
+		if (report)
+			console_out_f (_T(" SP: %08X %08X\n"), r1->sp2, r2->sp2);
+		ok = false;
+	}
+	if (r1->fault != r2->fault) {
+		if (report)
+			console_out_f (_T(" Fault: %d %d\n"), r1->fault, r2->fault);
+		ok = false;
+	}
+	for (int i = 0; i < CPUTEST_SIZE; i++) {
+		if (mem1[i] != mem2[i]) {
+			if (report)
+				console_out_f (_T(" Memory %08X: %02X %02X\n"), i, mem1[i], mem2[i]);
+			ok = false;
+			break;
+		}
+	}
+	return ok;
+}
+
+void cpu_selftest (int count, int core1, int core2, uae_u32 seed)
+{
+	int lvl = get_cpu_level ();
+	int cores[2] = { core1, core2 };
+	cpuop_func **functbls[2];
+	uae_u8 *mem, *savemem, *initmem, *resmem[2];
+	struct regstruct saveregs, initregs;
+	struct cputest_result res[2];
+	int savecompatible = currprefs.cpu_compatible;
+	int savecycleexact = currprefs.cpu_cycle_exact;
+	int savepcindirect = m68k_pc_indirect;
+	uae_u16 savedmacon = dmacon;
+	uae_u32 saverand = uaerandgetseed ();
+	int tested = 0, errors = 0, bitfield = 0;
+
+	if (currprefs.mmu_model || currprefs.cachesize) {
+		console_out (_T("CPU self test does not support MMU or JIT configurations.\n"));
+		return;
+	}
+	if (!valid_address (0, CPUTEST_SIZE)) {
+		console_out (_T("CPU self test needs at least 128k of chip RAM.\n"));
+		return;
+	}
+	for (int i = 0; i < 2; i++) {
+		if (cores[i] < 0 || cores[i] > 3 || cputbls[lvl][cores[i]] == NULL) {
+			console_out_f (_T("CPU core %d not available.\n"), cores[i]);
+			return;
+		}
+	}
+
+	mem = get_real_address (0);
+	savemem = xmalloc (uae_u8, CPUTEST_SIZE);
+	initmem = xmalloc (uae_u8, CPUTEST_SIZE);
+	resmem[0] = xmalloc (uae_u8, CPUTEST_SIZE);
+	resmem[1] = xmalloc (uae_u8, CPUTEST_SIZE);
+	for (int i = 0; i < 2; i++) {
+		functbls[i] = xmalloc (cpuop_func*, 65536);
+		build_functbl (functbls[i], cputbls[lvl][cores[i]], lvl);
+	}
+	memcpy (savemem, mem, CPUTEST_SIZE);
+	saveregs = regs;
+	// cycle-exact core runs the chipset, keep DMA away from the random chip RAM
+	dmacon = 0;
+
+	console_out_f (_T("CPU %d self test, %s vs %s, seed %08X, %d instructions\n"),
+		currprefs.cpu_model, cputest_names[cores[0]], cputest_names[cores[1]], seed, count);
+	uaesrand (seed);
+	while (tested < count) {
+		uae_u16 opcode = uaerand () & 0xffff;
+		if (!cputest_opcode (opcode, lvl))
+			continue;
+
+		/* random data area, exception vectors to handler, stack filled with even addresses */
+		for (int i = 0; i < CPUTEST_SIZE; i += 4)
+			do_put_mem_long ((uae_u32*)(initmem + i), uaerand ());
+		for (int i = 0; i < 256 * 4; i += 4)
+			do_put_mem_long ((uae_u32*)(initmem + i), CPUTEST_HANDLER);
+		for (int i = CPUTEST_USP - 0x1000; i < CPUTEST_ISP + 0x1000; i += 4)
+			do_put_mem_long ((uae_u32*)(initmem + i), 0x8000 + (uaerand () & 0x7ffe));
+		do_put_mem_word ((uae_u16*)(initmem + CPUTEST_CODE), opcode);
+
+		initregs = saveregs;
+		for (int i = 0; i < 8; i++)
+			initregs.regs[i] = uaerand ();
+		for (int i = 8; i < 15; i++)
+			initregs.regs[i] = 0x8000 + (uaerand () & 0x7ffe);
+		initregs.regs[15] = CPUTEST_ISP;
+		initregs.usp = CPUTEST_USP;
+		initregs.isp = CPUTEST_ISP;
+		initregs.msp = CPUTEST_ISP;
+		initregs.vbr = 0;
+		initregs.cacr = 0;
+		initregs.spcflags = 0;
+		initregs.stopped = 0;
+		initregs.s = 1;
+		initregs.m = 0;
+		initregs.t0 = initregs.t1 = 0;
+		initregs.intmask = 7;
+		initregs.sr = 0x2700 | (uaerand () & 0x1f);
+		regs = initregs;
+		MakeFromSR ();
+		initregs = regs;
+
+		for (int i = 0; i < 2; i++) {
+			cputest_run (functbls[i], cores[i], opcode, mem, initmem, &initregs, &res[i]);
+			memcpy (resmem[i], mem, CPUTEST_SIZE);
+		}
+		tested++;
+		if (table68k[opcode].mnemo >= i_BFTST && table68k[opcode].mnemo <= i_BFINS)
+			bitfield++;
+
+		if (!cputest_compare (&res[0], &res[1], resmem[0], resmem[1], false)) {
+			errors++;
+			if (errors <= CPUTEST_MAXERRORS) {
+				TCHAR buf[256];
+				memcpy (mem, initmem, CPUTEST_SIZE);
+				regs = initregs;
+				m68k_disasm_2 (buf, sizeof buf / sizeof (TCHAR), CPUTEST_CODE, NULL, 1, NULL, NULL, 1);
+				console_out_f (_T("Mismatch %d, opcode %04X SR=%04X:\n%s"), errors, opcode, initregs.sr, buf);
+				cputest_compare (&res[0], &res[1], resmem[0], resmem[1], true);
+			}
+		}
+	}
+
+	memcpy (mem, savemem, CPUTEST_SIZE);
+	dmacon = savedmacon;
+	currprefs.cpu_compatible = savecompatible;
+	currprefs.cpu_cycle_exact = savecycleexact;
+	m68k_pc_indirect = savepcindirect;
+	set_x_funcs ();
+	regs = saveregs;
+	flush_cpu_caches (true);
+	uaesrand (saverand);
+
+	console_out_f (_T("%d instructions tested (%d bitfield), %d mismatches.\n"), tested, bitfield, errors);
+
+	for (int i = 0; i < 2; i++) {
+		xfree (functbls[i]);
+		xfree (resmem[i]);
+	}
+	xfree (initmem);
+	xfree (savemem);
+}
+
 #ifdef SAVESTATE
 
 /* CPU save/restore code */
@@ -5690,6 +6033,7 @@ uae_u8 *restore_cpu (uae_u8 *src)
 						icaches040[i].valid[j] = restore_u16() & 1;
 					}
 				}
+				icache040_pd_reset ();
 				regs.prefetch020addr = restore_u32();
 				regs.cacheholdingaddr020 = restore_u32();
 				regs.cacheholdingdata020 = restore_u32();
@@ -6782,6 +7126,7 @@ uae_u32 fill_icache040(uae_u32 addr)
 	int index, i, lws;
 	uae_u32 tag;
 	struct cache040 *c;
+	struct icache040_pd *pd;
 	int line;
 
 	if (!(regs.cacr & 0x8000)) {
@@ -6806,9 +7151,18 @@ uae_u32 fill_icache040(uae_u32 addr)
 		return regs.prefetch020[lws];
 	}
 
+	lws = (addr >> 2) & 3;
+	// only this function replaces lines and a line is only referenced by
+	// the lookaside entry of its own parity, valid bit is enough.
+	pd = &icache040_pd[(addr >> 4) & 1];
+	if (pd->key == ((addr & ~15) | regs.s) && pd->c->valid[pd->line]) {
+		icachelinecnt++;
+		x_do_cycles(1 * cpucycleunit);
+		return pd->c->data[pd->line][lws];
+	}
+
 	index = (addr >> 4) & (CACHESETS040 - 1);
 	tag = regs.s | (addr & ~((CACHESETS040 << 4) - 1));
-	lws = (addr >> 2) & 3;
 	addr &= ~15;
 	c = &icaches040[index];
 	for (i = 0; i < CACHELINES040; i++) {
@@ -6816,6 +7170,9 @@ uae_u32 fill_icache040(uae_u32 addr)
 			// cache hit
 			icachelinecnt++;
 			x_do_cycles(1 * cpucycleunit);
+			pd->key = addr | regs.s;
+			pd->c = c;
+			pd->line = i;
 			return c->data[i][lws];
 		}
 	}
@@ -6831,6 +7188,9 @@ uae_u32 fill_icache040(uae_u32 addr)
 	}
 	c->tag[line] = tag;
 	c->valid[line] = true;
+	pd->key = addr | regs.s;
+	pd->c = c;
+	pd->line = line;
 	if (currprefs.cpu_cycle_exact) {
 		c->data[line][0] = mem_access_delay_longi_read_ce020(addr +  0);
 		c->data[line][1] = mem_access_delay_longi_read_ce020(addr +  4);
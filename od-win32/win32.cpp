@@ -5317,6 +5317,10 @@ static int parseargs (const TCHAR *argx, const TCHAR *np, const TCHAR *np2)
 		quit_to_gui = 1;
 		return 1;
 	}
+	if (!_tcscmp (arg, _T("customstats")) && np) {
+		custom_wstats_enable (np);
+		return 2;
+	}
 	if (!_tcscmp (arg, _T("ini")) && np) {
 		inipath = my_strdup (np);
 		return 2;
@@ -56,6 +56,7 @@
 #include "autoconf.h"
 #include "custom.h"
 #include "newcpu.h"
+#include "events.h"
 #include "savestate.h"
 #include "uae.h"
 #include "gui.h"
@@ -1492,7 +1493,7 @@ retry2:
 	tlen += len;
 	p += len;
 
-	if (bufcheck (st, p, 0))
+	if (bufcheck (st, p, 4 + 4 + 4 + ev2_max * (1 + 8 + 4)))
 		goto retry;
 	p3 = p;
 	save_u32_func (&p, 0);